@@ -0,0 +1,548 @@
+﻿// ContainerBench.cpp
+// Microbenchmarks for Vector, HashMap and Map against std::vector,
+// std::unordered_map and std::map, with the key types the Level 4 program
+// hashes: short numeric municipality codes and names with diacritics.
+// PackedColumn is timed against a plain Vector<int> of population-like counts.
+// HashMap runs with its FastHash default and again with std::hash, and both
+// hashers are also timed on their own ("hash" rows).
+// Every result is one record (CSV by default, --format jsonl for JSON lines):
+//     benchmark, container, key, size, buckets, load_factor, ops, ns_per_op
+// Each measurement is repeated until it has run for --min-ms and the best of
+// --reps such runs is reported, so numbers are stable enough to diff between builds.
+
+#include <iostream>         // For the result output
+#include <string>           // For std::string keys
+#include <cstdint>          // For uint64_t checksums
+#include <cstdlib>          // For std::strtoul
+#include <chrono>           // For the timers
+#include <vector>           // Baseline
+#include <unordered_map>    // Baseline
+#include <map>              // Baseline
+#include <utility>          // For std::move
+#include <stdexcept>        // For std::runtime_error
+
+#include "Vector.h"
+#include "HashMap.h"
+#include "Map.h"
+#include "PackedColumns.h"
+#include "ResultWriter.h"
+
+// === Keeping results alive ===
+// Every benchmark folds what it computed into this, so nothing is optimized away
+static volatile uint64_t g_sink = 0;
+
+static void consume(uint64_t v) { g_sink = g_sink + v; }
+
+// === Keys ===
+// Unique municipality-style codes: region number + number within the region
+static Vector<std::string> makeCodes(size_t n, size_t offset) {
+    Vector<std::string> keys;
+    keys.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        size_t k = i + offset;
+        std::string region = std::to_string(101 + (k / 997) % 899);
+        std::string local = std::to_string(k % 997 + 1000 * (k / (997 * 899)));
+        while (local.size() < 3) local = "0" + local;
+        keys.push_back(region + local);
+    }
+    return keys;
+}
+
+// Unique names: mixed-radix syllables (some with umlauts / sharp s), like "Großkirchen"
+static Vector<std::string> makeNames(size_t n, size_t offset) {
+    static const char* const HEADS[] = { "Groß", "Klein", "Sankt ", "Bad ", "Neu", "Ober", "Unter", "Alt",
+        "Hoch", "Maria " };
+    static const char* const ROOTS[] = { "Kirch", "Pöls", "Mür", "Wald", "Stein", "Brück", "Feld", "Lärch",
+        "Haus", "Süß", "Berg", "Thal", "Weiß", "Dorn", "Öd", "Zell" };
+    static const char* const TAILS[] = { "dorf", "berg", "bach", "au", "en", "ing", "hof", "stätten",
+        "brunn", "heim", "see", "markt" };
+    Vector<std::string> keys;
+    keys.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        size_t k = i + offset;
+        std::string s = HEADS[k % 10];
+        k /= 10;
+        s += ROOTS[k % 16];
+        k /= 16;
+        s += TAILS[k % 12];
+        k /= 12;
+        if (k > 0) s += " " + std::to_string(k);   // Beyond 1920 combinations
+        keys.push_back(s);
+    }
+    return keys;
+}
+
+// Same keys in a scrambled order (lookups should not walk memory in insert order)
+static Vector<std::string> shuffled(const Vector<std::string>& keys) {
+    Vector<std::string> out = keys;
+    uint64_t x = 0x2545F4914F6CDD1Dull;
+    for (size_t i = out.size(); i > 1; --i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        size_t j = static_cast<size_t>(x % i);
+        std::swap(out[i - 1], out[j]);
+    }
+    return out;
+}
+
+// === Timing ===
+struct BenchConfig {
+    double minMs = 50.0;
+    int reps = 5;
+};
+
+// Best time per operation of 'body', which performs 'ops' operations per call
+template<typename Body>
+static double measure(const BenchConfig& cfg, size_t ops, Body body) {
+    using Clock = std::chrono::steady_clock;
+    body();                                       // Warm-up (page faults, caches)
+    double best = 1e300;
+    for (int r = 0; r < cfg.reps; ++r) {
+        size_t calls = 0;
+        Clock::time_point start = Clock::now();
+        double elapsed = 0.0;
+        do {
+            body();
+            ++calls;
+            elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        } while (elapsed < cfg.minMs * 1e6);
+        double perOp = elapsed / (static_cast<double>(calls) * (ops ? ops : 1));
+        if (perOp < best) best = perOp;
+    }
+    return best;
+}
+
+struct Report {
+    ResultWriter& out;
+    const BenchConfig& cfg;
+
+    void record(const char* bench, const char* container, const char* key, size_t size,
+        size_t buckets, double nsPerOp, size_t ops)
+    {
+        out.beginRecord();
+        out.field("benchmark", bench);
+        out.field("container", container);
+        out.field("key", key);
+        out.field("size", size);
+        out.field("buckets", buckets);
+        out.field("load_factor", buckets ? static_cast<double>(size) / buckets : 0.0);
+        out.field("ops", ops);
+        out.field("ns_per_op", nsPerOp);
+        out.endRecord();
+        out.flush();
+    }
+};
+
+// === Vector vs std::vector ===
+static void benchVector(Report& rep, size_t n, const Vector<std::string>& names) {
+    const BenchConfig& cfg = rep.cfg;
+
+    // push_back from empty: growth and reallocation
+    rep.record("push_back_int", "Vector", "int", n, 0, measure(cfg, n, [&]() {
+        Vector<int> v;
+        for (size_t i = 0; i < n; ++i) v.push_back(static_cast<int>(i));
+        consume(v.size());
+    }), n);
+    rep.record("push_back_int", "std::vector", "int", n, 0, measure(cfg, n, [&]() {
+        std::vector<int> v;
+        for (size_t i = 0; i < n; ++i) v.push_back(static_cast<int>(i));
+        consume(v.size());
+    }), n);
+    rep.record("push_back_string", "Vector", "name", n, 0, measure(cfg, n, [&]() {
+        Vector<std::string> v;
+        for (size_t i = 0; i < n; ++i) v.push_back(names[i]);
+        consume(v.size());
+    }), n);
+    rep.record("push_back_string", "std::vector", "name", n, 0, measure(cfg, n, [&]() {
+        std::vector<std::string> v;
+        for (size_t i = 0; i < n; ++i) v.push_back(names[i]);
+        consume(v.size());
+    }), n);
+
+    // Copy and move of a vector of names (per element for copy, per vector for move)
+    Vector<std::string> ours = names;
+    std::vector<std::string> theirs(names.begin(), names.end());
+    rep.record("copy_string", "Vector", "name", n, 0, measure(cfg, n, [&]() {
+        Vector<std::string> c = ours;
+        consume(c.size());
+    }), n);
+    rep.record("copy_string", "std::vector", "name", n, 0, measure(cfg, n, [&]() {
+        std::vector<std::string> c = theirs;
+        consume(c.size());
+    }), n);
+    rep.record("move_string", "Vector", "name", n, 0, measure(cfg, 1, [&]() {
+        Vector<std::string> c = std::move(ours);
+        ours = std::move(c);
+        consume(ours.size());
+    }), 1);
+    rep.record("move_string", "std::vector", "name", n, 0, measure(cfg, 1, [&]() {
+        std::vector<std::string> c = std::move(theirs);
+        theirs = std::move(c);
+        consume(theirs.size());
+    }), 1);
+
+    // Sequential iteration
+    Vector<int> vi;
+    std::vector<int> si;
+    for (size_t i = 0; i < n; ++i) {
+        vi.push_back(static_cast<int>(i));
+        si.push_back(static_cast<int>(i));
+    }
+    rep.record("iterate_int", "Vector", "int", n, 0, measure(cfg, n, [&]() {
+        uint64_t s = 0;
+        for (int x : vi) s += static_cast<uint64_t>(x);
+        consume(s);
+    }), n);
+    rep.record("iterate_int", "std::vector", "int", n, 0, measure(cfg, n, [&]() {
+        uint64_t s = 0;
+        for (int x : si) s += static_cast<uint64_t>(x);
+        consume(s);
+    }), n);
+}
+
+// === Hash functions ===
+// Raw hashing throughput: the FastHash default against std::hash
+template<typename Hash, typename Key>
+static void benchHash(Report& rep, const char* label, const char* keyName, const Vector<Key>& keys) {
+    const size_t n = keys.size();
+    Hash h;
+    rep.record("hash", label, keyName, n, 0, measure(rep.cfg, n, [&]() {
+        uint64_t s = 0;
+        for (size_t i = 0; i < n; ++i) s += h(keys[i]);
+        consume(s);
+    }), n);
+}
+
+// === HashMap vs std::unordered_map ===
+// HashMap never rehashes, so its load factor is size / buckets as constructed.
+// 'Hash' is the map's hasher and 'label' the container name it is reported under.
+template<typename Hash>
+static void benchHashMap(Report& rep, const char* label, const char* keyName, const Vector<std::string>& keys,
+    const Vector<std::string>& missing, size_t buckets)
+{
+    using Table = HashMap<std::string, int, HeapAllocator, Hash>;
+    const BenchConfig& cfg = rep.cfg;
+    const size_t n = keys.size();
+    Vector<std::string> order = shuffled(keys);
+
+    rep.record("insert", label, keyName, n, buckets, measure(cfg, n, [&]() {
+        Table m(buckets);
+        for (size_t i = 0; i < n; ++i) m[keys[i]] = static_cast<int>(i);
+        consume(static_cast<uint64_t>(*m.find(keys[0])));
+    }), n);
+
+    Table m(buckets);
+    for (size_t i = 0; i < n; ++i) m[keys[i]] = static_cast<int>(i);
+    rep.record("find_hit", label, keyName, n, buckets, measure(cfg, n, [&]() {
+        uint64_t s = 0;
+        for (size_t i = 0; i < n; ++i) s += static_cast<uint64_t>(*m.find(order[i]));
+        consume(s);
+    }), n);
+    rep.record("find_miss", label, keyName, n, buckets, measure(cfg, missing.size(), [&]() {
+        uint64_t s = 0;
+        for (size_t i = 0; i < missing.size(); ++i) s += m.find(missing[i]) ? 1 : 0;
+        consume(s);
+    }), missing.size());
+    rep.record("index_hit", label, keyName, n, buckets, measure(cfg, n, [&]() {
+        uint64_t s = 0;
+        for (size_t i = 0; i < n; ++i) s += static_cast<uint64_t>(m[order[i]]);
+        consume(s);
+    }), n);
+}
+
+static void benchUnorderedMap(Report& rep, const char* keyName, const Vector<std::string>& keys,
+    const Vector<std::string>& missing)
+{
+    const BenchConfig& cfg = rep.cfg;
+    const size_t n = keys.size();
+    Vector<std::string> order = shuffled(keys);
+
+    rep.record("insert", "std::unordered_map", keyName, n, 0, measure(cfg, n, [&]() {
+        std::unordered_map<std::string, int> m;
+        for (size_t i = 0; i < n; ++i) m[keys[i]] = static_cast<int>(i);
+        consume(m.size());
+    }), n);
+
+    std::unordered_map<std::string, int> m;
+    for (size_t i = 0; i < n; ++i) m[keys[i]] = static_cast<int>(i);
+    rep.record("find_hit", "std::unordered_map", keyName, n, m.bucket_count(), measure(cfg, n, [&]() {
+        uint64_t s = 0;
+        for (size_t i = 0; i < n; ++i) s += static_cast<uint64_t>(m.find(order[i])->second);
+        consume(s);
+    }), n);
+    rep.record("find_miss", "std::unordered_map", keyName, n, m.bucket_count(), measure(cfg, missing.size(), [&]() {
+        uint64_t s = 0;
+        for (size_t i = 0; i < missing.size(); ++i) s += m.find(missing[i]) != m.end() ? 1 : 0;
+        consume(s);
+    }), missing.size());
+    rep.record("index_hit", "std::unordered_map", keyName, n, m.bucket_count(), measure(cfg, n, [&]() {
+        uint64_t s = 0;
+        for (size_t i = 0; i < n; ++i) s += static_cast<uint64_t>(m[order[i]]);
+        consume(s);
+    }), n);
+}
+
+// === Map vs std::map ===
+// Map is a sorted vector: one-at-a-time inserts in random order shift half the
+// entries each, so that case only runs up to MAP_RANDOM_INSERT_MAX keys;
+// insert_batch (one sort) runs at every size.
+static const size_t MAP_RANDOM_INSERT_MAX = 10000;
+
+static void benchMap(Report& rep, const char* keyName, const Vector<std::string>& keys) {
+    const BenchConfig& cfg = rep.cfg;
+    const size_t n = keys.size();
+    Vector<std::string> order = shuffled(keys);
+
+    if (n <= MAP_RANDOM_INSERT_MAX) {
+        rep.record("insert", "Map", keyName, n, 0, measure(cfg, n, [&]() {
+            Map<std::string, int> m;
+            for (size_t i = 0; i < n; ++i) m[order[i]] = static_cast<int>(i);
+            consume(static_cast<uint64_t>(m.begin()->second));
+        }), n);
+        rep.record("insert", "std::map", keyName, n, 0, measure(cfg, n, [&]() {
+            std::map<std::string, int> m;
+            for (size_t i = 0; i < n; ++i) m[order[i]] = static_cast<int>(i);
+            consume(m.size());
+        }), n);
+    }
+
+    Vector<std::pair<std::string, int>> pairs;
+    for (size_t i = 0; i < n; ++i) pairs.push_back(std::pair<std::string, int>(order[i], static_cast<int>(i)));
+    rep.record("insert_batch", "Map", keyName, n, 0, measure(cfg, n, [&]() {
+        Map<std::string, int> m;
+        m.insert(pairs.begin(), pairs.end());
+        consume(m.size());
+    }), n);
+    rep.record("insert_batch", "std::map", keyName, n, 0, measure(cfg, n, [&]() {
+        std::map<std::string, int> m;
+        m.insert(pairs.begin(), pairs.end());
+        consume(m.size());
+    }), n);
+
+    Map<std::string, int> ours;
+    std::map<std::string, int> theirs;
+    for (size_t i = 0; i < n; ++i) {
+        ours[keys[i]] = static_cast<int>(i);
+        theirs[keys[i]] = static_cast<int>(i);
+    }
+    rep.record("find_hit", "Map", keyName, n, 0, measure(cfg, n, [&]() {
+        uint64_t s = 0;
+        for (size_t i = 0; i < n; ++i) s += static_cast<uint64_t>(ours.find(order[i])->second);
+        consume(s);
+    }), n);
+    rep.record("find_hit", "std::map", keyName, n, 0, measure(cfg, n, [&]() {
+        uint64_t s = 0;
+        for (size_t i = 0; i < n; ++i) s += static_cast<uint64_t>(theirs.find(order[i])->second);
+        consume(s);
+    }), n);
+    rep.record("iterate", "Map", keyName, n, 0, measure(cfg, n, [&]() {
+        uint64_t s = 0;
+        for (auto it = ours.begin(); it != ours.end(); ++it) s += static_cast<uint64_t>(it->second);
+        consume(s);
+    }), n);
+    rep.record("iterate", "std::map", keyName, n, 0, measure(cfg, n, [&]() {
+        uint64_t s = 0;
+        for (auto it = theirs.begin(); it != theirs.end(); ++it) s += static_cast<uint64_t>(it->second);
+        consume(s);
+    }), n);
+    rep.record("copy", "Map", keyName, n, 0, measure(cfg, n, [&]() {
+        Map<std::string, int> c = ours;
+        consume(c.size());
+    }), n);
+    rep.record("copy", "std::map", keyName, n, 0, measure(cfg, n, [&]() {
+        std::map<std::string, int> c = theirs;
+        consume(c.size());
+    }), n);
+}
+
+// === PackedColumn vs Vector<int> ===
+// Population-like counts: mostly small municipalities, now and then a large one
+static Vector<int> makePopulations(size_t n) {
+    Vector<int> v;
+    uint32_t x = 2463534242u;
+    for (size_t i = 0; i < n; ++i) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        v.push_back(static_cast<int>(x % 64 == 0 ? x % 200000 : 200 + x % 6000));
+    }
+    return v;
+}
+
+static void benchPacked(Report& rep, size_t n) {
+    const BenchConfig& cfg = rep.cfg;
+    Vector<int> plain = makePopulations(n);
+    PackedColumn packed;
+    packed.encode(plain.data(), n);
+    Vector<int> out;
+    out.resize(n);
+
+    rep.record("encode", "PackedColumn", "pop", n, 0, measure(cfg, n, [&]() {
+        PackedColumn c;
+        c.encode(plain.data(), n);
+        consume(c.blockCount());
+    }), n);
+    rep.record("decode", "PackedColumn", "pop", n, 0, measure(cfg, n, [&]() {
+        packed.decode(out.data());
+        consume(static_cast<uint64_t>(out[n - 1]));
+    }), n);
+    rep.record("decode", "Vector", "pop", n, 0, measure(cfg, n, [&]() {
+        for (size_t i = 0; i < n; ++i) out[i] = plain[i];
+        consume(static_cast<uint64_t>(out[n - 1]));
+    }), n);
+    rep.record("sum", "PackedColumn", "pop", n, 0, measure(cfg, n, [&]() {
+        consume(static_cast<uint64_t>(packed.sum()));
+    }), n);
+    rep.record("sum", "Vector", "pop", n, 0, measure(cfg, n, [&]() {
+        long long s = 0;
+        for (size_t i = 0; i < n; ++i) s += plain[i];
+        consume(static_cast<uint64_t>(s));
+    }), n);
+
+    // Rows with at least 5000 inhabitants (a few percent)
+    Vector<uint32_t> rows;
+    rep.record("select", "PackedColumn", "pop", n, 0, measure(cfg, n, [&]() {
+        rows.clear();
+        packed.selectBetween(5000, 1 << 30, rows);
+        consume(rows.size());
+    }), n);
+    rep.record("select", "Vector", "pop", n, 0, measure(cfg, n, [&]() {
+        rows.clear();
+        for (size_t i = 0; i < n; ++i) {
+            if (plain[i] >= 5000) rows.push_back(static_cast<uint32_t>(i));
+        }
+        consume(rows.size());
+    }), n);
+
+    // Random single reads
+    Vector<uint32_t> at;
+    uint64_t x = 88172645463325252ULL;
+    for (size_t i = 0; i < n; ++i) {
+        x = mix64(x + i);
+        at.push_back(static_cast<uint32_t>(x % n));
+    }
+    rep.record("get", "PackedColumn", "pop", n, 0, measure(cfg, n, [&]() {
+        uint64_t s = 0;
+        for (size_t i = 0; i < n; ++i) s += static_cast<uint64_t>(packed.get(at[i]));
+        consume(s);
+    }), n);
+    rep.record("get", "Vector", "pop", n, 0, measure(cfg, n, [&]() {
+        uint64_t s = 0;
+        for (size_t i = 0; i < n; ++i) s += static_cast<uint64_t>(plain[at[i]]);
+        consume(s);
+    }), n);
+}
+
+// "1000,0.5,16" → {1000, 0.5, 16}
+static Vector<double> parseNumbers(const std::string& list) {
+    Vector<double> out;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        if (comma == std::string::npos) comma = list.size();
+        std::string item = list.substr(start, comma - start);
+        if (!item.empty()) out.push_back(std::strtod(item.c_str(), nullptr));
+        start = comma + 1;
+    }
+    return out;
+}
+
+static void usage() {
+    std::cout
+        << "ContainerBench [options]\n"
+        << "  --sizes N,N,..        element counts (default 1000,10000,100000)\n"
+        << "  --load-factors X,..   HashMap keys per bucket (default 0.5,1,4,16; the 101-bucket default is always run)\n"
+        << "  --only vector|hashmap|map|packed   run one group\n"
+        << "  --min-ms X            minimum time per repetition (default 50)\n"
+        << "  --reps N              repetitions, best one reported (default 5)\n"
+        << "  --format csv|jsonl    output format (default csv)\n";
+}
+
+int main(int argc, char** argv) {
+    BenchConfig cfg;
+    Vector<double> sizes = parseNumbers("1000,10000,100000");
+    Vector<double> loadFactors = parseNumbers("0.5,1,4,16");
+    std::string only;
+    OutputFormat fmt = OutputFormat::Csv;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                usage();
+                return 0;
+            }
+            if (i + 1 >= argc) throw std::runtime_error("missing value for " + arg);
+            std::string v = argv[++i];
+            if (arg == "--sizes")        sizes = parseNumbers(v);
+            else if (arg == "--load-factors") loadFactors = parseNumbers(v);
+            else if (arg == "--only")    only = v;
+            else if (arg == "--min-ms")  cfg.minMs = std::strtod(v.c_str(), nullptr);
+            else if (arg == "--reps")    cfg.reps = std::atoi(v.c_str());
+            else if (arg == "--format") {
+                if (!parseOutputFormat(v, fmt) || fmt == OutputFormat::Text) {
+                    throw std::runtime_error("--format expects csv or jsonl");
+                }
+            }
+            else throw std::runtime_error("unknown option " + arg);
+        }
+        if (cfg.reps < 1) cfg.reps = 1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        usage();
+        return 1;
+    }
+
+    std::ios::sync_with_stdio(false);
+    ResultWriter out(std::cout, fmt);
+    Report rep{ out, cfg };
+    for (size_t s = 0; s < sizes.size(); ++s) {
+        size_t n = static_cast<size_t>(sizes[s]);
+        if (n == 0) continue;
+        Vector<std::string> codes = makeCodes(n, 0);
+        Vector<std::string> codeMisses = makeCodes(n, n);      // Never inserted
+        Vector<std::string> names = makeNames(n, 0);
+        Vector<std::string> nameMisses = makeNames(n, n);
+
+        if (only.empty() || only == "vector") {
+            benchVector(rep, n, names);
+        }
+        if (only.empty() || only == "hashmap") {
+            Vector<uint32_t> ints;
+            for (size_t i = 0; i < n; ++i) ints.push_back(static_cast<uint32_t>(i * 2654435761u));
+            benchHash<FastHash<std::string>>(rep, "FastHash", "code", codes);
+            benchHash<std::hash<std::string>>(rep, "std::hash", "code", codes);
+            benchHash<FastHash<std::string>>(rep, "FastHash", "name", names);
+            benchHash<std::hash<std::string>>(rep, "std::hash", "name", names);
+            benchHash<FastHash<uint32_t>>(rep, "FastHash", "int", ints);
+            benchHash<std::hash<uint32_t>>(rep, "std::hash", "int", ints);
+
+            benchHashMap<FastHash<std::string>>(rep, "HashMap", "code", codes, codeMisses, 101);
+            benchHashMap<std::hash<std::string>>(rep, "HashMap<std::hash>", "code", codes, codeMisses, 101);
+            benchHashMap<FastHash<std::string>>(rep, "HashMap", "name", names, nameMisses, 101);
+            benchHashMap<std::hash<std::string>>(rep, "HashMap<std::hash>", "name", names, nameMisses, 101);
+            for (size_t f = 0; f < loadFactors.size(); ++f) {
+                if (loadFactors[f] <= 0.0) continue;
+                size_t buckets = static_cast<size_t>(n / loadFactors[f]);
+                if (buckets < 1) buckets = 1;
+                benchHashMap<FastHash<std::string>>(rep, "HashMap", "code", codes, codeMisses, buckets);
+                benchHashMap<std::hash<std::string>>(rep, "HashMap<std::hash>", "code", codes, codeMisses, buckets);
+                benchHashMap<FastHash<std::string>>(rep, "HashMap", "name", names, nameMisses, buckets);
+                benchHashMap<std::hash<std::string>>(rep, "HashMap<std::hash>", "name", names, nameMisses, buckets);
+            }
+            benchUnorderedMap(rep, "code", codes, codeMisses);
+            benchUnorderedMap(rep, "name", names, nameMisses);
+        }
+        if (only.empty() || only == "map") {
+            benchMap(rep, "code", codes);
+            benchMap(rep, "name", names);
+        }
+        if (only.empty() || only == "packed") {
+            benchPacked(rep, n);
+        }
+    }
+    consume(0);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,418 @@
+﻿// DataGenerator.cpp
+// Writes a synthetic dataset in the exact format the Level 4 loaders read:
+//     country.csv         Name;<CODE>;;;;;          (GeoDivs, states, regions)
+//     municipalities.csv  Name;<code>;REGIONCODE
+//     YYYY.csv            header line, then Name;<code>;Male;;Female
+// Region codes follow the loader's rules: "AT" plus one character per level, the
+// parent being the code minus its last character, so there are always three
+// region levels (GeoDiv, State, Region); their fan-outs are configurable.
+// Everything is derived from the seed with integer hashing and exactly rounded
+// floating-point operations only (no library exp/log), so a seed produces the
+// same files on every platform. Memory use does not depend on the municipality
+// count: municipalities are generated and written as a stream.
+
+#include <iostream>         // For progress and usage output
+#include <fstream>          // For the output files
+#include <string>           // For std::string
+#include <cstdint>          // For uint64_t hashing
+#include <cstdlib>          // For std::strtoull / std::strtod
+#include <cmath>            // For std::ldexp / std::floor
+#include <chrono>           // For the elapsed time
+#include <stdexcept>        // For std::runtime_error
+
+#include "Vector.h"
+
+// === Deterministic randomness ===
+// SplitMix64: one independent stream per (seed, purpose, index)
+static uint64_t mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+class Random {
+private:
+    uint64_t state;
+
+public:
+    Random(uint64_t seed, uint64_t stream, uint64_t index)
+        : state(mix64(mix64(seed ^ (stream * 0xD1B54A32D192ED03ull)) + index)) {}
+
+    uint64_t next() {
+        state += 0x9E3779B97F4A7C15ull;
+        return mix64(state);
+    }
+
+    // Uniform in [0, 1) with 53 random bits
+    double uniform() { return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0); }
+
+    // Uniform in [0, n)
+    size_t below(size_t n) { return static_cast<size_t>(uniform() * static_cast<double>(n)); }
+
+    bool chance(double p) { return uniform() < p; }
+
+    // Standard normal, approximated by the sum of twelve uniforms (Irwin–Hall)
+    double normal() {
+        double s = 0.0;
+        for (int i = 0; i < 12; ++i) s += uniform();
+        return s - 6.0;
+    }
+};
+
+// e^x from + - * / and ldexp only (identical on every platform)
+static double detExp(double x) {
+    if (x > 700.0) x = 700.0;
+    if (x < -700.0) x = -700.0;
+    const double LN2 = 0.6931471805599453;
+    double k = std::floor(x / LN2 + 0.5);
+    double r = x - k * LN2;               // |r| <= ln2 / 2
+    double term = 1.0, sum = 1.0;
+    for (int i = 1; i < 18; ++i) {
+        term = term * r / i;
+        sum += term;
+    }
+    return std::ldexp(sum, static_cast<int>(k));
+}
+
+// === Names ===
+// Built from German-looking syllables; 'diacritics' is the chance that a vowel
+// or an 'ss' is written with its umlaut / sharp-s form (UTF-8).
+static const char* const ONSETS[] = { "B", "D", "F", "G", "H", "K", "L", "M", "N", "P", "R", "S", "T", "W", "Z",
+    "Br", "Gr", "Kr", "Pr", "Tr", "St", "Sch", "Pf", "Kl", "Fl" };
+static const char* const MIDDLES[] = { "r", "l", "n", "m", "d", "t", "rg", "nd", "lz", "ch", "ck", "tt", "ss" };
+static const char* const VOWELS[] = { "a", "e", "i", "o", "u", "ei", "au", "ie" };
+static const char* const UMLAUTS[] = { "ä", "ë", "ï", "ö", "ü", "äu", "eu", "é" };
+static const char* const SUFFIXES[] = { "dorf", "berg", "bach", "au", "feld", "hof", "kirchen", "stein",
+    "brunn", "wald", "heim", "ing", "stätten", "hausen", "markt", "tal", "see", "leiten" };
+static const char* const PREFIXES[] = { "Sankt ", "Bad ", "Maria ", "Neu", "Alt", "Ober", "Unter", "Groß",
+    "Klein", "Hoch", "Markt " };
+static const char* const RIVERS[] = { "Donau", "Enns", "Mur", "Drau", "Inn", "Traun", "Ybbs", "Raab",
+    "Leitha", "Thaya", "Salzach", "Lafnitz" };
+static const char* const REGION_WORDS[] = { "Viertel", "Land", "Gau", "Tal", "Umgebung", "Becken" };
+
+template<size_t N>
+static const char* pick(Random& rnd, const char* const (&list)[N]) {
+    return list[rnd.below(N)];
+}
+
+static std::string vowel(Random& rnd, double diacritics) {
+    size_t i = rnd.below(sizeof(VOWELS) / sizeof(VOWELS[0]));
+    return rnd.chance(diacritics) ? UMLAUTS[i] : VOWELS[i];
+}
+
+// Root of a name: onset + vowel (+ middle + vowel) + suffix
+static std::string nameRoot(Random& rnd, double diacritics) {
+    std::string s = pick(rnd, ONSETS);
+    s += vowel(rnd, diacritics);
+    if (rnd.chance(0.5)) {
+        std::string mid = pick(rnd, MIDDLES);
+        if (mid == "ss" && rnd.chance(diacritics)) mid = "ß";
+        s += mid;
+        s += vowel(rnd, diacritics);
+    }
+    std::string suffix = pick(rnd, SUFFIXES);
+    if (suffix == "see" && rnd.chance(diacritics)) suffix = "sée";
+    return s + suffix;
+}
+
+// Municipality name; optional prefix and "an der <river>" style tails
+static std::string municipalityName(uint64_t seed, uint64_t index, double diacritics) {
+    Random rnd(seed, 1, index);
+    std::string name;
+    if (rnd.chance(0.12)) {
+        std::string prefix = pick(rnd, PREFIXES);
+        std::string root = nameRoot(rnd, diacritics);
+        // "Neu" + "Dorf" → "Neudorf"; "Sankt " keeps the capital
+        if (prefix[prefix.size() - 1] != ' ') root[0] = static_cast<char>(root[0] - 'A' + 'a');
+        name = prefix + root;
+    }
+    else {
+        name = nameRoot(rnd, diacritics);
+    }
+    double tail = rnd.uniform();
+    if (tail < 0.05)      name += std::string(" an der ") + pick(rnd, RIVERS);
+    else if (tail < 0.08) name += std::string(" am ") + nameRoot(rnd, diacritics);
+    else if (tail < 0.10) name += std::string("-") + nameRoot(rnd, diacritics);
+    return name;
+}
+
+// === Output ===
+// Lines collect in a string and reach the file in large writes
+class CsvFile {
+private:
+    std::ofstream out;
+    std::string buf;
+    std::string path;
+    uint64_t bytes = 0;
+
+public:
+    explicit CsvFile(const std::string& p) : out(p, std::ios::binary), path(p) {
+        if (!out) throw std::runtime_error("Cannot create " + p);
+        buf.reserve(1 << 20);
+    }
+
+    // Errors surface through written(); a destructor must not throw
+    ~CsvFile() {
+        try {
+            flush();
+        }
+        catch (const std::exception&) {
+        }
+    }
+
+    std::string& line() { return buf; }
+
+    void endLine() {
+        buf += '\n';
+        if (buf.size() >= (1 << 20)) flush();
+    }
+
+    void flush() {
+        if (buf.empty()) return;
+        out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+        if (!out) throw std::runtime_error("Write failed: " + path);
+        bytes += buf.size();
+        buf.clear();
+    }
+
+    uint64_t written() { flush(); return bytes; }
+};
+
+// === Generator ===
+struct Options {
+    std::string outDir = ".";
+    uint64_t seed = 1;
+    uint64_t municipalities = 100000;
+    size_t geoDivs = 3;          // GeoDivs under the country
+    size_t states = 3;           // States per GeoDiv
+    size_t regions = 4;          // Regions per state
+    int firstYear = 2020;
+    int years = 5;
+    double meanPopulation = 4000.0;
+    double spread = 1.1;         // Log-normal sigma of municipality sizes
+    double growth = 0.01;        // Year-to-year change sigma
+    double diacritics = 0.15;    // Chance of an umlaut / sharp s per vowel or 'ss'
+    double duplicates = 0.03;    // Chance of reusing a popular earlier name
+};
+
+// Code character for child number i (1..9, then A..Z, a..z)
+static char codeChar(size_t i) {
+    static const char CHARS[] = "123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    return CHARS[i];
+}
+static const size_t MAX_FANOUT = 61;
+
+static size_t digits(uint64_t n) {
+    size_t d = 1;
+    while (n >= 10) {
+        n /= 10;
+        ++d;
+    }
+    return d;
+}
+
+static void appendPadded(std::string& s, uint64_t v, size_t width) {
+    std::string num = std::to_string(v);
+    if (num.size() < width) s.append(width - num.size(), '0');
+    s += num;
+}
+
+static void generate(const Options& o) {
+    std::string dir = o.outDir.empty() ? "." : o.outDir;
+
+    // (1) Region tree: GeoDiv → State → Region, written to country.csv
+    Vector<std::string> regionCodes;
+    {
+        CsvFile country(dir + "/country.csv");
+        for (size_t g = 0; g < o.geoDivs; ++g) {
+            std::string gc = std::string("AT") + codeChar(g);
+            Random rnd(o.seed, 2, g);
+            country.line() += nameRoot(rnd, o.diacritics) + " " + pick(rnd, REGION_WORDS) + ";<" + gc + ">;;;;;";
+            country.endLine();
+        }
+        for (size_t g = 0; g < o.geoDivs; ++g) {
+            for (size_t s = 0; s < o.states; ++s) {
+                std::string sc = std::string("AT") + codeChar(g) + codeChar(s);
+                Random rnd(o.seed, 3, g * MAX_FANOUT + s);
+                country.line() += nameRoot(rnd, o.diacritics) + ";<" + sc + ">;;;;;";
+                country.endLine();
+            }
+        }
+        for (size_t g = 0; g < o.geoDivs; ++g) {
+            for (size_t s = 0; s < o.states; ++s) {
+                for (size_t r = 0; r < o.regions; ++r) {
+                    std::string rc = std::string("AT") + codeChar(g) + codeChar(s) + codeChar(r);
+                    Random rnd(o.seed, 4, (g * MAX_FANOUT + s) * MAX_FANOUT + r);
+                    country.line() += nameRoot(rnd, o.diacritics) + "-" + pick(rnd, REGION_WORDS) + ";<" + rc + ">;;;;;";
+                    country.endLine();
+                    regionCodes.push_back(rc);
+                }
+            }
+        }
+    }
+
+    // (2) Municipalities per region: uneven shares that add up to the total
+    const size_t regionCount = regionCodes.size();
+    Vector<uint64_t> perRegion;
+    {
+        Vector<double> weight;
+        double sum = 0.0;
+        Random rnd(o.seed, 5, 0);
+        for (size_t r = 0; r < regionCount; ++r) {
+            weight.push_back(0.4 + rnd.uniform());
+            sum += weight[r];
+        }
+        uint64_t given = 0;
+        for (size_t r = 0; r < regionCount; ++r) {
+            uint64_t n = static_cast<uint64_t>(static_cast<double>(o.municipalities) * weight[r] / sum);
+            perRegion.push_back(n);
+            given += n;
+        }
+        for (size_t r = 0; given < o.municipalities; r = (r + 1) % regionCount, ++given) {
+            ++perRegion[r];
+        }
+    }
+    uint64_t largest = 0;
+    for (size_t r = 0; r < regionCount; ++r) {
+        if (perRegion[r] > largest) largest = perRegion[r];
+    }
+    // Numeric municipality codes: region number + number within the region
+    const size_t regionWidth = digits(regionCount);
+    const size_t localWidth = digits(largest);
+
+    // (3) municipalities.csv and every YYYY.csv in one streaming pass
+    CsvFile munis(dir + "/municipalities.csv");
+    Vector<CsvFile*> yearFiles;
+    for (int y = 0; y < o.years; ++y) {
+        yearFiles.push_back(new CsvFile(dir + "/" + std::to_string(o.firstYear + y) + ".csv"));
+        yearFiles[y]->line() += "Municipality;<Code>;Male;;Female";   // Skipped by the loaders
+        yearFiles[y]->endLine();
+    }
+
+    const uint64_t popularNames = 1000;   // Duplicates are drawn from the first names
+    uint64_t index = 0;
+    uint64_t nextReport = 0;
+    for (size_t r = 0; r < regionCount; ++r) {
+        for (uint64_t k = 0; k < perRegion[r]; ++k, ++index) {
+            Random rnd(o.seed, 6, index);
+
+            std::string name;
+            if (index >= popularNames && rnd.chance(o.duplicates)) {
+                double u = rnd.uniform();
+                name = municipalityName(o.seed, static_cast<uint64_t>(u * u * popularNames), o.diacritics);
+            }
+            else {
+                name = municipalityName(o.seed, index, o.diacritics);
+            }
+            std::string code;
+            appendPadded(code, r + 1, regionWidth);
+            appendPadded(code, k + 1, localWidth);
+
+            munis.line() += name + ";<" + code + ">;" + regionCodes[r];
+            munis.endLine();
+
+            // Log-normal size with the requested mean, then a random walk over the years
+            double pop = o.meanPopulation * detExp(o.spread * rnd.normal() - o.spread * o.spread / 2.0);
+            double maleShare = 0.47 + 0.06 * rnd.uniform();
+            double trend = o.growth * 0.5 * rnd.normal();
+            for (int y = 0; y < o.years; ++y) {
+                if (y > 0) pop *= 1.0 + trend + o.growth * rnd.normal();
+                if (pop < 1.0) pop = 1.0;
+                if (pop > 2.0e9) pop = 2.0e9;
+                long long total = static_cast<long long>(pop + 0.5);
+                long long male = static_cast<long long>(static_cast<double>(total) * maleShare + 0.5);
+                std::string& line = yearFiles[y]->line();
+                line += name;
+                line += ";<";
+                line += code;
+                line += ">;";
+                line += std::to_string(male);
+                line += ";;";
+                line += std::to_string(total - male);
+                yearFiles[y]->endLine();
+            }
+        }
+        if (index >= nextReport) {
+            std::cerr << "\r[generate] " << index << " / " << o.municipalities << " municipalities" << std::flush;
+            nextReport = index + o.municipalities / 20;
+        }
+    }
+    std::cerr << "\n";
+
+    uint64_t bytes = munis.written();
+    for (size_t y = 0; y < yearFiles.size(); ++y) {
+        bytes += yearFiles[y]->written();
+        delete yearFiles[y];
+    }
+    std::cout << "Wrote " << regionCount << " regions, " << o.municipalities << " municipalities, "
+        << o.years << " year files (" << o.firstYear << "-" << (o.firstYear + o.years - 1) << "), "
+        << bytes << " bytes to " << dir << "\n";
+}
+
+static void usage() {
+    std::cout
+        << "DataGenerator [options]\n"
+        << "  --out DIR            output directory (default .)\n"
+        << "  --seed N             random seed (default 1)\n"
+        << "  --municipalities N   number of municipalities (default 100000)\n"
+        << "  --fanout G,S,R       GeoDivs, states per GeoDiv, regions per state (default 3,3,4; each 1-61)\n"
+        << "  --first-year Y       first year file (default 2020)\n"
+        << "  --years N            number of year files (default 5; Level 4 reads 2020-2024)\n"
+        << "  --mean-pop X         mean municipality population (default 4000)\n"
+        << "  --spread X           log-normal sigma of municipality sizes (default 1.1)\n"
+        << "  --growth X           sigma of the yearly change (default 0.01)\n"
+        << "  --diacritics P       chance of an umlaut / sharp s per vowel (default 0.15)\n"
+        << "  --duplicates P       chance of reusing a popular name (default 0.03)\n";
+}
+
+int main(int argc, char** argv) {
+    Options o;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                usage();
+                return 0;
+            }
+            if (i + 1 >= argc) throw std::runtime_error("missing value for " + arg);
+            std::string v = argv[++i];
+            if (arg == "--out")                 o.outDir = v;
+            else if (arg == "--seed")           o.seed = std::strtoull(v.c_str(), nullptr, 10);
+            else if (arg == "--municipalities") o.municipalities = std::strtoull(v.c_str(), nullptr, 10);
+            else if (arg == "--first-year")     o.firstYear = std::atoi(v.c_str());
+            else if (arg == "--years")          o.years = std::atoi(v.c_str());
+            else if (arg == "--mean-pop")       o.meanPopulation = std::strtod(v.c_str(), nullptr);
+            else if (arg == "--spread")         o.spread = std::strtod(v.c_str(), nullptr);
+            else if (arg == "--growth")         o.growth = std::strtod(v.c_str(), nullptr);
+            else if (arg == "--diacritics")     o.diacritics = std::strtod(v.c_str(), nullptr);
+            else if (arg == "--duplicates")     o.duplicates = std::strtod(v.c_str(), nullptr);
+            else if (arg == "--fanout") {
+                size_t p1 = v.find(',');
+                size_t p2 = p1 == std::string::npos ? p1 : v.find(',', p1 + 1);
+                if (p2 == std::string::npos) throw std::runtime_error("--fanout expects G,S,R");
+                o.geoDivs = std::strtoul(v.substr(0, p1).c_str(), nullptr, 10);
+                o.states = std::strtoul(v.substr(p1 + 1, p2 - p1 - 1).c_str(), nullptr, 10);
+                o.regions = std::strtoul(v.substr(p2 + 1).c_str(), nullptr, 10);
+            }
+            else throw std::runtime_error("unknown option " + arg);
+        }
+        if (o.geoDivs < 1 || o.geoDivs > MAX_FANOUT || o.states < 1 || o.states > MAX_FANOUT ||
+            o.regions < 1 || o.regions > MAX_FANOUT) {
+            throw std::runtime_error("every fan-out must be between 1 and 61 (one code character per level)");
+        }
+        if (o.years < 1) throw std::runtime_error("--years must be at least 1");
+        if (o.meanPopulation < 1.0) throw std::runtime_error("--mean-pop must be at least 1");
+
+        auto start = std::chrono::steady_clock::now();
+        generate(o);
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Done in " << secs << " s\n";
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        usage();
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
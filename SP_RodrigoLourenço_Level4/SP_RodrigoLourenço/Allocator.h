@@ -0,0 +1,260 @@
+// Allocator.h
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+#include <atomic>
+
+// Allocators used by Vector, SmallVector and HashMap.
+// Every allocator has the same small interface:
+//     void* allocate(size_t bytes, size_t align);
+//     void  deallocate(void* p, size_t bytes, size_t align);
+// where deallocate gets the same size and alignment the block was allocated with
+// and is cheap to copy (it is either empty or a single pointer).
+
+// Allocation counters, one set per allocator kind
+struct AllocStats {
+    std::atomic<size_t> allocations{ 0 };
+    std::atomic<size_t> deallocations{ 0 };
+    std::atomic<size_t> bytes{ 0 };       // Total bytes ever handed out
+
+    void onAlloc(size_t n) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(n, std::memory_order_relaxed);
+    }
+    void onFree() {
+        deallocations.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+// === Global heap (the default for every container) ===
+// Alignments above what plain new guarantees go through the aligned new/delete.
+class HeapAllocator {
+public:
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        stats().onAlloc(bytes);
+        if (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) return operator new[](bytes, std::align_val_t(align));
+        return operator new[](bytes);
+    }
+    void deallocate(void* p, size_t, size_t align = alignof(std::max_align_t)) {
+        if (!p) return;
+        stats().onFree();
+        if (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) operator delete[](p, std::align_val_t(align));
+        else operator delete[](p);
+    }
+
+    static AllocStats& stats() {
+        static AllocStats s;
+        return s;
+    }
+};
+
+// === Monotonic bump arena ===
+// Hands out memory from large chunks by bumping a pointer. Individual
+// deallocation is a no-op; everything is freed at once by release().
+class MonotonicArena {
+private:
+    struct Chunk {
+        Chunk* next;
+        size_t size;      // Usable bytes after the header
+    };
+
+    Chunk* head = nullptr;
+    char* cur = nullptr;
+    char* end = nullptr;
+    size_t chunkSize;
+    size_t reserved = 0;  // Bytes obtained from the heap
+    size_t used = 0;      // Bytes handed out
+    size_t allocs = 0;    // Number of allocate() calls
+    size_t chunks = 0;
+
+    static size_t headerSize() {
+        return (sizeof(Chunk) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    }
+
+    void newChunk(size_t atLeast) {
+        size_t sz = (atLeast > chunkSize ? atLeast : chunkSize);
+        char* raw = static_cast<char*>(operator new(headerSize() + sz));
+        Chunk* c = reinterpret_cast<Chunk*>(raw);
+        c->next = head;
+        c->size = sz;
+        head = c;
+        cur = raw + headerSize();
+        end = cur + sz;
+        reserved += headerSize() + sz;
+        chunks++;
+    }
+
+    static MonotonicArena*& currentSlot() {
+        thread_local MonotonicArena* p = nullptr;
+        return p;
+    }
+
+public:
+    explicit MonotonicArena(size_t chunkBytes = 64 * 1024) : chunkSize(chunkBytes) {}
+    ~MonotonicArena() { release(); }
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        if (bytes == 0) bytes = 1;
+        size_t pad = (align - (reinterpret_cast<size_t>(cur) & (align - 1))) & (align - 1);
+        if (cur == nullptr || pad + bytes > static_cast<size_t>(end - cur)) {
+            newChunk(bytes + align);
+            pad = (align - (reinterpret_cast<size_t>(cur) & (align - 1))) & (align - 1);
+        }
+        char* p = cur + pad;
+        cur = p + bytes;
+        used += bytes;
+        allocs++;
+        return p;
+    }
+
+    void deallocate(void*, size_t, size_t = alignof(std::max_align_t)) {
+        // Monotonic: memory comes back only through release()
+    }
+
+    // Free every chunk in one go
+    void release() {
+        while (head) {
+            Chunk* next = head->next;
+            operator delete(head);
+            head = next;
+        }
+        cur = end = nullptr;
+        reserved = used = allocs = chunks = 0;
+    }
+
+    size_t bytesUsed() const { return used; }
+    size_t bytesReserved() const { return reserved; }
+    size_t allocationCount() const { return allocs; }
+    size_t chunkCount() const { return chunks; }
+
+    // Arena that default-constructed ArenaAllocators bind to on this thread
+    static MonotonicArena* current() { return currentSlot(); }
+    static MonotonicArena* setCurrent(MonotonicArena* a) {
+        MonotonicArena* old = currentSlot();
+        currentSlot() = a;
+        return old;
+    }
+};
+
+// === Size-class pool ===
+// Small blocks (up to 512 bytes) are rounded up to a power-of-two size class
+// and recycled through per-class free lists. Larger blocks go to the heap.
+// Alignments above alignof(std::max_align_t) are honoured for pooled blocks
+// (a recycled block that is not aligned enough is left on its list) and by
+// the heap for larger ones.
+// Not thread-safe: its owner serializes access (see ResultCache).
+class SizeClassPool {
+private:
+    static const size_t MIN_CLASS = 16;
+    static const size_t NUM_CLASSES = 6;   // 16, 32, 64, 128, 256, 512
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    FreeBlock* freeLists[NUM_CLASSES] = {};
+    MonotonicArena backing;
+
+    static size_t classIndex(size_t bytes) {
+        size_t idx = 0;
+        size_t sz = MIN_CLASS;
+        while (sz < bytes) {
+            sz <<= 1;
+            idx++;
+        }
+        return idx;
+    }
+
+public:
+    SizeClassPool() : backing(32 * 1024) {}
+
+    SizeClassPool(const SizeClassPool&) = delete;
+    SizeClassPool& operator=(const SizeClassPool&) = delete;
+
+    static size_t maxPooledSize() { return MIN_CLASS << (NUM_CLASSES - 1); }
+
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        if (align < alignof(std::max_align_t)) align = alignof(std::max_align_t);
+        if (bytes > maxPooledSize()) return HeapAllocator().allocate(bytes, align);
+        stats().onAlloc(bytes);
+        size_t idx = classIndex(bytes);
+        FreeBlock* b = freeLists[idx];
+        if (b && (reinterpret_cast<size_t>(b) & (align - 1)) == 0) {
+            freeLists[idx] = b->next;   // Reuse a recycled block
+            return b;
+        }
+        return backing.allocate(MIN_CLASS << idx, align);
+    }
+
+    void deallocate(void* p, size_t bytes, size_t align = alignof(std::max_align_t)) {
+        if (!p) return;
+        if (bytes > maxPooledSize()) {
+            HeapAllocator().deallocate(p, bytes, align < alignof(std::max_align_t) ? alignof(std::max_align_t) : align);
+            return;
+        }
+        stats().onFree();
+        size_t idx = classIndex(bytes);
+        FreeBlock* b = static_cast<FreeBlock*>(p);
+        b->next = freeLists[idx];
+        freeLists[idx] = b;
+    }
+
+    size_t bytesReserved() const { return backing.bytesReserved(); }
+
+    // Counters shared by all pools (pooled sizes only)
+    static AllocStats& stats() {
+        static AllocStats s;
+        return s;
+    }
+};
+
+// === Container-facing handles ===
+
+// Allocates from a MonotonicArena. A default-constructed handle binds to the
+// arena that is current on this thread, or to the heap when there is none.
+class ArenaAllocator {
+private:
+    MonotonicArena* arena;
+
+public:
+    ArenaAllocator() : arena(MonotonicArena::current()) {}
+    explicit ArenaAllocator(MonotonicArena* a) : arena(a) {}
+
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        if (arena) return arena->allocate(bytes, align);
+        return HeapAllocator().allocate(bytes, align);
+    }
+    void deallocate(void* p, size_t bytes, size_t align = alignof(std::max_align_t)) {
+        if (!arena) HeapAllocator().deallocate(p, bytes, align);
+    }
+
+    MonotonicArena* resource() const { return arena; }
+};
+
+// Allocates from a SizeClassPool (heap when constructed without one)
+class PoolAllocator {
+private:
+    SizeClassPool* pool;
+
+public:
+    PoolAllocator() : pool(nullptr) {}
+    explicit PoolAllocator(SizeClassPool* p) : pool(p) {}
+
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        if (pool) return pool->allocate(bytes, align);
+        return HeapAllocator().allocate(bytes, align);
+    }
+    void deallocate(void* p, size_t bytes, size_t align = alignof(std::max_align_t)) {
+        if (pool) pool->deallocate(p, bytes, align);
+        else HeapAllocator().deallocate(p, bytes, align);
+    }
+
+    SizeClassPool* resource() const { return pool; }
+};
+
+#endif // ALLOCATOR_H
@@ -0,0 +1,54 @@
+// FenwickTree.h
+#ifndef FENWICKTREE_H
+#define FENWICKTREE_H
+
+#include <cstddef>
+#include "Vector.h"
+
+// Binary indexed tree over n values: prefix and range sums in O(log n), and
+// point updates in O(log n) without rebuilding anything.
+template<typename T>
+class FenwickTree {
+private:
+    Vector<T> tree;     // 1-based: tree[i] covers (i - lowbit(i), i]
+
+    static size_t lowbit(size_t i) { return i & (~i + 1); }
+
+public:
+    // Build from values[0, n) in O(n)
+    void build(const T* values, size_t n) {
+        tree.clear();
+        tree.resize(n + 1);
+        for (size_t i = 1; i <= n; ++i) {
+            tree[i] += values[i - 1];
+            size_t parent = i + lowbit(i);
+            if (parent <= n) tree[parent] += tree[i];
+        }
+    }
+
+    size_t size() const { return tree.empty() ? 0 : tree.size() - 1; }
+    size_t memoryBytes() const { return sizeof(*this) + tree.capacity() * sizeof(T); }
+
+    // values[i] += delta
+    void add(size_t i, T delta) {
+        for (size_t k = i + 1; k < tree.size(); k += lowbit(k)) {
+            tree[k] += delta;
+        }
+    }
+
+    // Sum of values[0, end)
+    T prefix(size_t end) const {
+        T sum = T();
+        for (size_t k = end; k > 0; k -= lowbit(k)) {
+            sum += tree[k];
+        }
+        return sum;
+    }
+
+    // Sum of values[lo, hi)
+    T rangeSum(size_t lo, size_t hi) const {
+        return hi > lo ? prefix(hi) - prefix(lo) : T();
+    }
+};
+
+#endif // FENWICKTREE_H
\ No newline at end of file
@@ -0,0 +1,73 @@
+// Hash.h
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+
+// 64-bit finalizer (MurmurHash3 fmix64): every input bit reaches every output bit
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// Word-at-a-time hash for short byte strings: one multiply per 8 bytes, the
+// 1–7 byte tail read with fixed-size loads (two overlapping 4-byte words, or
+// first/middle/last byte), one final mix. Codes (5 bytes) take one round,
+// typical names two or three. The length seeds the state, so tails whose
+// loads overlap still hash apart from shorter keys.
+inline uint64_t hashBytes(const void* data, size_t n) {
+    const uint64_t K = 0x9E3779B97F4A7C15ULL;
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    uint64_t h = static_cast<uint64_t>(n) * K;
+    while (n >= 8) {
+        uint64_t w;
+        std::memcpy(&w, p, 8);
+        h = (h ^ w) * K;
+        h = (h << 31) | (h >> 33);
+        p += 8;
+        n -= 8;
+    }
+    if (n >= 4) {
+        uint32_t lo, hi;
+        std::memcpy(&lo, p, 4);
+        std::memcpy(&hi, p + n - 4, 4);
+        h = (h ^ ((static_cast<uint64_t>(hi) << 32) | lo)) * K;
+    }
+    else if (n > 0) {
+        uint64_t w = (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[n >> 1]) << 8) | p[n - 1];
+        h = (h ^ w) * K;
+    }
+    return mix64(h);
+}
+
+// Default hasher of HashMap: hashBytes for strings, mix64 for integers,
+// std::hash for everything else
+template<typename K, typename Enable = void>
+struct FastHash {
+    size_t operator()(const K& key) const { return std::hash<K>{}(key); }
+};
+
+template<>
+struct FastHash<std::string> {
+    size_t operator()(const std::string& key) const {
+        return static_cast<size_t>(hashBytes(key.data(), key.size()));
+    }
+};
+
+template<typename K>
+struct FastHash<K, typename std::enable_if<std::is_integral<K>::value>::type> {
+    size_t operator()(K key) const {
+        return static_cast<size_t>(mix64(static_cast<uint64_t>(key)));
+    }
+};
+
+#endif // HASH_H
\ No newline at end of file
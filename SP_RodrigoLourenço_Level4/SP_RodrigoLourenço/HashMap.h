@@ -2,37 +2,101 @@
 #ifndef HASHMAP_H
 #define HASHMAP_H
 
-#include <functional>
+#include <new>
+#include <cstdint>
+#ifdef HASHMAP_DEBUG
+#  include <atomic>
+#endif
 #include "Vector.h"
+#include "Hash.h"
+#include "Stats.h"
 
-template<typename K, typename V>
+// Shape of a HashMap at one moment (see HashMap::inspect)
+struct HashMapStats {
+    size_t size = 0;
+    size_t bucketCount = 0;
+    size_t usedBuckets = 0;         // Buckets holding at least one entry
+    size_t maxChain = 0;            // Longest bucket
+    double loadFactor = 0.0;        // Entries per bucket
+    double meanChain = 0.0;         // Entries per non-empty bucket
+    double meanProbesHit = 0.0;     // Keys compared by a successful lookup, averaged over all keys
+                                    // (a failed lookup compares loadFactor keys on average)
+    Vector<size_t> chainHistogram;  // [k] = number of buckets holding exactly k entries
+    size_t memoryBytes = 0;         // Map object, bucket array and entry storage (not what keys/values own)
+
+    // Measured since construction; only counted in HASHMAP_DEBUG builds
+    uint64_t lookups = 0;
+    uint64_t probes = 0;            // Keys compared over all lookups
+    uint64_t maxProbes = 0;         // Most keys compared by one lookup
+};
+
+// Alloc is used for the bucket array and for every bucket's entry storage;
+// Hash maps a key to a size_t (FastHash by default, see Hash.h)
+template<typename K, typename V, typename Alloc = HeapAllocator, typename Hash = FastHash<K>>
 class HashMap {
 private:
     struct Entry {
         K key;
         V value;
     };
+    using Bucket = Vector<Entry, Alloc>;
 
-    Vector<Entry>* buckets;
+    Bucket* buckets;
     size_t bucketCount;
+    size_t count = 0;
+    Alloc alloc;
+    Hash hasher;
+#ifdef HASHMAP_DEBUG
+    // Per-map probe counters (atomic: const lookups may run on several threads)
+    mutable std::atomic<uint64_t> debugLookups{ 0 };
+    mutable std::atomic<uint64_t> debugProbes{ 0 };
+    mutable std::atomic<uint64_t> debugMaxProbes{ 0 };
+#endif
 
     // Compute bucket index from key
     size_t hashKey(const K& key) const {
-        return std::hash<K>{}(key) % bucketCount;
+        return hasher(key) % bucketCount;
+    }
+
+    // One lookup that compared 'probes' keys in a chain of 'chain' entries
+    // (global counters with SP_STATS, this map's counters with HASHMAP_DEBUG)
+    void countLookup(size_t probes, size_t chain) const {
+        STATS_COUNT(HashLookups, 1);
+        STATS_COUNT(HashProbes, probes);
+        STATS_MAX(HashChainMax, chain);
+#ifdef HASHMAP_DEBUG
+        debugLookups.fetch_add(1, std::memory_order_relaxed);
+        debugProbes.fetch_add(probes, std::memory_order_relaxed);
+        uint64_t seen = debugMaxProbes.load(std::memory_order_relaxed);
+        while (seen < probes && !debugMaxProbes.compare_exchange_weak(seen, probes, std::memory_order_relaxed)) {
+        }
+#endif
+        (void)probes;
+        (void)chain;
     }
 
 public:
     // Constructor: create “initBuckets” empty buckets
-    HashMap(size_t initBuckets = 101) {
+    HashMap(size_t initBuckets = 101, const Alloc& a = Alloc(), const Hash& h = Hash()) : alloc(a), hasher(h) {
         bucketCount = initBuckets;
-        buckets = new Vector<Entry>[bucketCount];
+        buckets = static_cast<Bucket*>(alloc.allocate(bucketCount * sizeof(Bucket), alignof(Bucket)));
+        for (size_t i = 0; i < bucketCount; ++i) {
+            new (&buckets[i]) Bucket(alloc);
+        }
     }
 
     // Destructor: only deletes the bucket‐array; does NOT delete any V inside
     ~HashMap() {
-        delete[] buckets;
+        for (size_t i = 0; i < bucketCount; ++i) {
+            buckets[i].~Bucket();
+        }
+        alloc.deallocate(buckets, bucketCount * sizeof(Bucket), alignof(Bucket));
     }
 
+    // Owns raw bucket storage, so copying would double-free
+    HashMap(const HashMap&) = delete;
+    HashMap& operator=(const HashMap&) = delete;
+
     // [] operator: if “key” exists, return reference to its value;
     // otherwise insert (key, V()) and return reference to the newly inserted V.
     V& operator[](const K& key) {
@@ -40,14 +104,17 @@ public:
         auto& bucket = buckets[idx];
         for (size_t i = 0; i < bucket.size(); ++i) {
             if (bucket[i].key == key) {
+                countLookup(i + 1, bucket.size());
                 return bucket[i].value;
             }
         }
+        countLookup(bucket.size(), bucket.size());
         // Not found → insert new Entry
         Entry e;
         e.key = key;
         e.value = V();
-        bucket.push_back(e);
+        bucket.push_back(std::move(e));
+        ++count;
         return bucket[bucket.size() - 1].value;
     }
 
@@ -57,23 +124,88 @@ public:
         auto& bucket = buckets[idx];
         for (size_t i = 0; i < bucket.size(); ++i) {
             if (bucket[i].key == key) {
+                countLookup(i + 1, bucket.size());
                 return &bucket[i].value;
             }
         }
+        countLookup(bucket.size(), bucket.size());
         return nullptr;
     }
 
+    // erase(key): remove the entry if present; returns whether one was removed
+    bool erase(const K& key) {
+        auto& bucket = buckets[hashKey(key)];
+        for (size_t i = 0; i < bucket.size(); ++i) {
+            if (bucket[i].key == key) {
+                countLookup(i + 1, bucket.size());
+                if (i + 1 < bucket.size()) {
+                    bucket[i] = std::move(bucket[bucket.size() - 1]);
+                }
+                bucket.pop_back();
+                --count;
+                return true;
+            }
+        }
+        countLookup(bucket.size(), bucket.size());
+        return false;
+    }
+
     // const‐version of find
     const V* find(const K& key) const {
         size_t idx = hashKey(key);
         auto& bucket = buckets[idx];
         for (size_t i = 0; i < bucket.size(); ++i) {
             if (bucket[i].key == key) {
+                countLookup(i + 1, bucket.size());
                 return &bucket[i].value;
             }
         }
+        countLookup(bucket.size(), bucket.size());
         return nullptr;
     }
+
+    // Hand every entry to f(key, value) as movable references, then empty the map
+    // (used to freeze a built map into a PerfectHashMap)
+    template<typename F>
+    void drain(F f) {
+        for (size_t i = 0; i < bucketCount; ++i) {
+            for (size_t j = 0; j < buckets[i].size(); ++j) {
+                f(buckets[i][j].key, buckets[i][j].value);
+            }
+            buckets[i].clear();
+        }
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+    size_t bucket_count() const { return bucketCount; }
+
+    // Walk every bucket: chain lengths, expected probes and memory footprint
+    HashMapStats inspect() const {
+        HashMapStats s;
+        s.size = count;
+        s.bucketCount = bucketCount;
+        s.memoryBytes = sizeof(*this) + bucketCount * sizeof(Bucket);
+        size_t hitProbes = 0;       // Sum over keys of their position in the chain (1-based)
+        for (size_t i = 0; i < bucketCount; ++i) {
+            size_t len = buckets[i].size();
+            if (len >= s.chainHistogram.size()) s.chainHistogram.resize(len + 1);
+            ++s.chainHistogram[len];
+            if (len > 0) ++s.usedBuckets;
+            if (len > s.maxChain) s.maxChain = len;
+            hitProbes += len * (len + 1) / 2;
+            s.memoryBytes += buckets[i].capacity() * sizeof(Entry);
+        }
+        s.loadFactor = bucketCount ? static_cast<double>(count) / bucketCount : 0.0;
+        s.meanChain = s.usedBuckets ? static_cast<double>(count) / s.usedBuckets : 0.0;
+        s.meanProbesHit = count ? static_cast<double>(hitProbes) / count : 0.0;
+#ifdef HASHMAP_DEBUG
+        s.lookups = debugLookups.load();
+        s.probes = debugProbes.load();
+        s.maxProbes = debugMaxProbes.load();
+#endif
+        return s;
+    }
 };
 
 #endif // HASHMAP_H
\ No newline at end of file
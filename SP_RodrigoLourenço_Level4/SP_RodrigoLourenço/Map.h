@@ -1,25 +1,94 @@
 // Map.h
 #ifndef MAP_H
 #define MAP_H
-#include <map>
 
-template<typename K, typename V>
+#include <algorithm>
+#include <utility>
+#include "Vector.h"
+
+// Ordered map kept as one sorted Vector of (key, value) pairs: lookups are binary
+// searches, iteration walks contiguous memory in key order (it->first, it->second),
+// and a copy is a single allocation. Keys arriving in ascending order are appended;
+// any other insert shifts the entries behind it, which is cheap for the small maps
+// this is used for (a handful of years per unit, the arguments of one query).
+// Large maps are better filled with insert(first, last), which sorts once.
+// Like Vector (and unlike std::map), inserting invalidates iterators and references.
+template<typename K, typename V, typename Alloc = HeapAllocator>
 class Map {
-    std::map<K, V> m_;
 public:
-    using iterator = typename std::map<K, V>::iterator;
-    using const_iterator = typename std::map<K, V>::const_iterator;
+    using value_type = std::pair<K, V>;
+    using iterator = value_type*;
+    using const_iterator = const value_type*;
+
+private:
+    Vector<value_type, Alloc> items_;
+
+    static bool keyBelow(const value_type& e, const K& k) { return e.first < k; }
+
+    iterator lowerBound(const K& k) {
+        return std::lower_bound(items_.begin(), items_.end(), k, keyBelow);
+    }
+    const_iterator lowerBound(const K& k) const {
+        return std::lower_bound(items_.begin(), items_.end(), k, keyBelow);
+    }
+
+public:
+    Map() = default;
+    explicit Map(const Alloc& a) : items_(a) {}
+
+    // Value of k, inserted as V() if absent
+    V& operator[](const K& k) {
+        if (items_.empty() || items_[items_.size() - 1].first < k) {
+            items_.push_back(value_type(k, V()));
+            return items_[items_.size() - 1].second;
+        }
+        iterator it = lowerBound(k);          // Not end(): the last key is >= k
+        if (!(k < it->first)) return it->second;
+        size_t pos = static_cast<size_t>(it - items_.begin());
+        items_.push_back(value_type(k, V()));
+        value_type fresh = std::move(items_[items_.size() - 1]);
+        std::move_backward(items_.begin() + pos, items_.end() - 1, items_.end());
+        items_[pos] = std::move(fresh);
+        return items_[pos].second;
+    }
+
+    iterator find(const K& k) {
+        iterator it = lowerBound(k);
+        return (it != end() && !(k < it->first)) ? it : end();
+    }
+    const_iterator find(const K& k) const {
+        const_iterator it = lowerBound(k);
+        return (it != end() && !(k < it->first)) ? it : end();
+    }
 
-    V& operator[](const K& k) { return m_[k]; }
-    iterator       find(const K& k) { return m_.find(k); }
-    const_iterator find(const K& k) const { return m_.find(k); }
+    // Batch insert with one sort; like std::map::insert, keys already present
+    // (or repeated within the batch) keep their first value
+    template<typename InputIt>
+    void insert(InputIt first, InputIt last) {
+        size_t before = items_.size();
+        for (; first != last; ++first) items_.push_back(value_type(first->first, first->second));
+        if (items_.size() == before) return;
+        std::stable_sort(items_.begin(), items_.end(), [](const value_type& a, const value_type& b) {
+            return a.first < b.first;
+        });
+        size_t kept = 0;
+        for (size_t i = 0; i < items_.size(); ++i) {
+            if (kept > 0 && !(items_[kept - 1].first < items_[i].first)) continue;
+            if (kept != i) items_[kept] = std::move(items_[i]);
+            ++kept;
+        }
+        while (items_.size() > kept) items_.pop_back();
+    }
 
-    iterator       begin() { return m_.begin(); }
-    const_iterator begin() const { return m_.begin(); }
-    iterator       end() { return m_.end(); }
-    const_iterator end()   const { return m_.end(); }
+    iterator       begin() { return items_.begin(); }
+    const_iterator begin() const { return items_.begin(); }
+    iterator       end() { return items_.end(); }
+    const_iterator end()   const { return items_.end(); }
 
-    void clear() { m_.clear(); }
+    size_t size() const { return items_.size(); }
+    bool empty() const { return items_.empty(); }
+    void reserve(size_t n) { items_.reserve(n); }
+    void clear() { items_.clear(); }
 };
 
-#endif
\ No newline at end of file
+#endif // MAP_H
\ No newline at end of file
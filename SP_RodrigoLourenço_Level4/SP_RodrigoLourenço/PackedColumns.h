@@ -0,0 +1,311 @@
+// PackedColumns.h
+#ifndef PACKEDCOLUMNS_H
+#define PACKEDCOLUMNS_H
+
+#include <cstddef>
+#include <cstdint>
+#include "Vector.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define PACKED_SSE2 1
+#endif
+
+// Bit-packed int columns with frame-of-reference encoding. A column is cut into
+// blocks of 128 values; each block stores its minimum and the offsets from it in
+// the fewest bits that hold the largest one (0 bits for a constant block).
+// Within a block the values are interleaved over 4 lanes as in SIMD-BP128:
+// value i goes to lane i % 4, and the 4 lanes' packed words alternate, so one
+// 128-bit load brings in the next word of every lane and a block decodes with
+// 4-wide shifts and masks (SSE2), or the same steps one lane at a time.
+namespace packed {
+
+const size_t BLOCK = 128;               // Values per block
+const size_t LANES = 4;                 // Interleaved lanes per block
+const size_t PER_LANE = BLOCK / LANES;  // Values per lane: 'bits' words per lane
+
+// Pack 128 offsets of 'bits' bits each into bits * 4 words
+inline void packBlock(const uint32_t* in, unsigned bits, uint32_t* out) {
+    if (bits == 0) return;
+    for (size_t lane = 0; lane < LANES; ++lane) {
+        uint64_t acc = 0;
+        unsigned filled = 0;
+        size_t w = 0;
+        for (size_t k = 0; k < PER_LANE; ++k) {
+            acc |= static_cast<uint64_t>(in[k * LANES + lane]) << filled;
+            filled += bits;
+            if (filled >= 32) {
+                out[w++ * LANES + lane] = static_cast<uint32_t>(acc);
+                acc >>= 32;
+                filled -= 32;
+            }
+        }
+    }
+}
+
+// Unpack 128 offsets of 'bits' bits each (inverse of packBlock)
+inline void unpackBlock(const uint32_t* in, unsigned bits, uint32_t* out) {
+    if (bits == 0) {
+        for (size_t i = 0; i < BLOCK; ++i) out[i] = 0;
+        return;
+    }
+#ifdef PACKED_SSE2
+    const __m128i mask = _mm_set1_epi32(bits == 32 ? -1 : static_cast<int>((1u << bits) - 1));
+    __m128i cur = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    unsigned shift = 0;
+    for (size_t k = 0; k < PER_LANE; ++k) {
+        __m128i v = _mm_srl_epi32(cur, _mm_cvtsi32_si128(static_cast<int>(shift)));
+        shift += bits;
+        if (shift >= 32) {
+            shift -= 32;
+            if (k + 1 < PER_LANE) {      // The last value never straddles two words
+                in += LANES;
+                cur = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+                if (shift > 0) v = _mm_or_si128(v, _mm_sll_epi32(cur, _mm_cvtsi32_si128(static_cast<int>(bits - shift))));
+            }
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + k * LANES), _mm_and_si128(v, mask));
+    }
+#else
+    const uint64_t mask = (static_cast<uint64_t>(1) << bits) - 1;
+    for (size_t lane = 0; lane < LANES; ++lane) {
+        uint64_t acc = 0;
+        unsigned avail = 0;
+        size_t w = 0;
+        for (size_t k = 0; k < PER_LANE; ++k) {
+            if (avail < bits) {
+                acc |= static_cast<uint64_t>(in[w++ * LANES + lane]) << avail;
+                avail += 32;
+            }
+            out[k * LANES + lane] = static_cast<uint32_t>(acc & mask);
+            acc >>= bits;
+            avail -= bits;
+        }
+    }
+#endif
+}
+
+// Bits needed for offsets up to 'range'
+inline unsigned bitWidth(uint32_t range) {
+    unsigned bits = 0;
+    while (bits < 32 && (range >> bits) != 0) ++bits;
+    return bits;
+}
+
+} // namespace packed
+
+// One column of ints, frame-of-reference bit-packed in blocks of packed::BLOCK.
+// Every block also keeps its exact maximum, so range scans skip blocks that
+// cannot match and take blocks that lie wholly inside the range without decoding.
+// add() changes one value by repacking only its block; a block's width can grow
+// that way but never shrinks until the column is encoded again.
+class PackedColumn {
+private:
+    struct Block {
+        int32_t min;
+        int32_t max;
+        uint32_t offset;    // First word of the block in 'words'
+        uint32_t bits;
+    };
+
+    Vector<Block> blocks;
+    Vector<uint32_t> words;
+    size_t count = 0;
+
+    size_t blockLength(size_t b) const {
+        size_t first = b * packed::BLOCK;
+        return count - first < packed::BLOCK ? count - first : packed::BLOCK;
+    }
+
+public:
+    // Encode n values (replaces the previous contents). Block widths are found
+    // first, so the words are allocated once at their exact size.
+    void encode(const int* values, size_t n) {
+        blocks.clear();
+        words.clear();
+        count = n;
+        blocks.reserve((n + packed::BLOCK - 1) / packed::BLOCK);
+        size_t total = 0;
+        for (size_t first = 0; first < n; first += packed::BLOCK) {
+            size_t len = n - first < packed::BLOCK ? n - first : packed::BLOCK;
+            Block blk;
+            blk.min = blk.max = values[first];
+            for (size_t i = 1; i < len; ++i) {
+                if (values[first + i] < blk.min) blk.min = values[first + i];
+                if (values[first + i] > blk.max) blk.max = values[first + i];
+            }
+            blk.bits = packed::bitWidth(static_cast<uint32_t>(blk.max) - static_cast<uint32_t>(blk.min));
+            blk.offset = static_cast<uint32_t>(total);
+            total += blk.bits * packed::LANES;
+            blocks.push_back(blk);
+        }
+        words.resize(total);
+        uint32_t offsets[packed::BLOCK];
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            const Block& blk = blocks[b];
+            size_t first = b * packed::BLOCK;
+            size_t len = blockLength(b);
+            for (size_t i = 0; i < packed::BLOCK; ++i) {
+                // A short last block is padded with its minimum (offset 0)
+                offsets[i] = i < len ? static_cast<uint32_t>(values[first + i]) - static_cast<uint32_t>(blk.min) : 0;
+            }
+            packed::packBlock(offsets, blk.bits, words.data() + blk.offset);
+        }
+    }
+
+    size_t size() const { return count; }
+    size_t blockCount() const { return blocks.size(); }
+
+    // Value i += delta. Only the block holding i is unpacked and packed again;
+    // the words after it move only when the block needs more bits than before.
+    void add(size_t i, int delta) {
+        if (delta == 0) return;
+        size_t b = i / packed::BLOCK;
+        size_t len = blockLength(b);
+        int values[packed::BLOCK];
+        decodeBlock(b, values);
+        values[i % packed::BLOCK] += delta;
+        int lo = values[0], hi = values[0];
+        for (size_t k = 1; k < len; ++k) {
+            if (values[k] < lo) lo = values[k];
+            if (values[k] > hi) hi = values[k];
+        }
+        Block& blk = blocks[b];
+        unsigned bits = packed::bitWidth(static_cast<uint32_t>(hi) - static_cast<uint32_t>(lo));
+        if (bits > blk.bits) {
+            // Open a gap for the wider block and shift the later blocks' words
+            size_t extra = (bits - blk.bits) * packed::LANES;
+            size_t tail = blk.offset + blk.bits * packed::LANES;    // First word after this block
+            size_t oldSize = words.size();
+            words.resize(oldSize + extra);
+            for (size_t w = oldSize; w > tail; --w) words[w - 1 + extra] = words[w - 1];
+            for (size_t k = b + 1; k < blocks.size(); ++k) blocks[k].offset += static_cast<uint32_t>(extra);
+            blk.bits = bits;
+        }
+        blk.min = lo;
+        blk.max = hi;
+        uint32_t offsets[packed::BLOCK];
+        for (size_t k = 0; k < packed::BLOCK; ++k) {
+            offsets[k] = k < len ? static_cast<uint32_t>(values[k]) - static_cast<uint32_t>(lo) : 0;
+        }
+        packed::packBlock(offsets, blk.bits, words.data() + blk.offset);
+    }
+
+    // Value i, read from its block without decoding the rest
+    int get(size_t i) const {
+        const Block& blk = blocks[i / packed::BLOCK];
+        if (blk.bits == 0) return blk.min;
+        size_t j = i % packed::BLOCK;
+        size_t bit = (j / packed::LANES) * blk.bits;
+        const uint32_t* lane = words.data() + blk.offset + j % packed::LANES;
+        uint64_t w = lane[(bit / 32) * packed::LANES];
+        if (bit % 32 + blk.bits > 32) w |= static_cast<uint64_t>(lane[(bit / 32 + 1) * packed::LANES]) << 32;
+        uint64_t mask = (static_cast<uint64_t>(1) << blk.bits) - 1;
+        return static_cast<int>(static_cast<uint32_t>(blk.min) + static_cast<uint32_t>((w >> (bit % 32)) & mask));
+    }
+
+    // All packed::BLOCK values of block b (a short last block is padded)
+    void decodeBlock(size_t b, int* out) const {
+        const Block& blk = blocks[b];
+        uint32_t offsets[packed::BLOCK];
+        packed::unpackBlock(words.data() + blk.offset, blk.bits, offsets);
+        for (size_t i = 0; i < packed::BLOCK; ++i) {
+            out[i] = static_cast<int>(static_cast<uint32_t>(blk.min) + offsets[i]);
+        }
+    }
+
+    // All values, into out[0, size())
+    void decode(int* out) const {
+        int buf[packed::BLOCK];
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            size_t len = blockLength(b);
+            int* dst = len == packed::BLOCK ? out + b * packed::BLOCK : buf;
+            decodeBlock(b, dst);
+            if (dst == buf) {
+                for (size_t i = 0; i < len; ++i) out[b * packed::BLOCK + i] = buf[i];
+            }
+        }
+    }
+
+    // acc[i] += value i for every value (decodes a delta column onto its base)
+    void addTo(int* acc) const {
+        int buf[packed::BLOCK];
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            size_t len = blockLength(b);
+            int* dst = acc + b * packed::BLOCK;
+            if (blocks[b].bits == 0) {
+                for (size_t i = 0; i < len; ++i) dst[i] += blocks[b].min;
+                continue;
+            }
+            decodeBlock(b, buf);
+            for (size_t i = 0; i < len; ++i) dst[i] += buf[i];
+        }
+    }
+
+    // Sum of values [lo, hi): the unpacked offsets are added up and the block
+    // minimum is added once per value; constant blocks are not unpacked at all
+    long long sum(size_t lo, size_t hi) const {
+        long long s = 0;
+        uint32_t offsets[packed::BLOCK];
+        for (size_t b = lo / packed::BLOCK; b < blocks.size() && b * packed::BLOCK < hi; ++b) {
+            const Block& blk = blocks[b];
+            size_t first = b * packed::BLOCK;
+            size_t from = lo > first ? lo - first : 0;
+            size_t to = hi - first < blockLength(b) ? hi - first : blockLength(b);
+            s += static_cast<long long>(blk.min) * static_cast<long long>(to - from);
+            if (blk.bits == 0) continue;
+            packed::unpackBlock(words.data() + blk.offset, blk.bits, offsets);
+            uint64_t o = 0;
+            for (size_t i = from; i < to; ++i) o += offsets[i];
+            s += static_cast<long long>(o);
+        }
+        return s;
+    }
+
+    long long sum() const { return sum(0, count); }
+
+    // Positions in [first, last) of the values within [lo, hi], ascending. Blocks
+    // outside the range are skipped and blocks inside it taken whole, both without decoding.
+    void selectBetween(int lo, int hi, size_t first, size_t last, Vector<uint32_t>& out) const {
+        int buf[packed::BLOCK];
+        for (size_t b = first / packed::BLOCK; b < blocks.size() && b * packed::BLOCK < last; ++b) {
+            const Block& blk = blocks[b];
+            if (blk.max < lo || blk.min > hi) continue;
+            size_t start = b * packed::BLOCK;
+            size_t from = first > start ? first - start : 0;
+            size_t to = last - start < blockLength(b) ? last - start : blockLength(b);
+            if (blk.min >= lo && blk.max <= hi) {
+                for (size_t i = from; i < to; ++i) out.push_back(static_cast<uint32_t>(start + i));
+                continue;
+            }
+            decodeBlock(b, buf);
+            for (size_t i = from; i < to; ++i) {
+                if (buf[i] >= lo && buf[i] <= hi) out.push_back(static_cast<uint32_t>(start + i));
+            }
+        }
+    }
+
+    void selectBetween(int lo, int hi, Vector<uint32_t>& out) const { selectBetween(lo, hi, 0, count, out); }
+
+    // Rough count of the values within [lo, hi] from the block bounds alone:
+    // blocks inside the range count whole, blocks straddling it half
+    size_t estimateBetween(int lo, int hi) const {
+        size_t n = 0;
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            const Block& blk = blocks[b];
+            if (blk.max < lo || blk.min > hi) continue;
+            n += (blk.min >= lo && blk.max <= hi) ? blockLength(b) : blockLength(b) / 2;
+        }
+        return n;
+    }
+
+    // Average packed width in bits per value
+    double meanBits() const {
+        return count ? 32.0 * static_cast<double>(words.size()) / static_cast<double>(count) : 0.0;
+    }
+
+    size_t memoryBytes() const {
+        return sizeof(*this) + blocks.capacity() * sizeof(Block) + words.capacity() * sizeof(uint32_t);
+    }
+};
+
+#endif // PACKEDCOLUMNS_H
\ No newline at end of file
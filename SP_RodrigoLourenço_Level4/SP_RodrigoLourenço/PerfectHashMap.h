@@ -0,0 +1,200 @@
+// PerfectHashMap.h
+#ifndef PERFECTHASHMAP_H
+#define PERFECTHASHMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#ifdef HASHMAP_DEBUG
+#  include <atomic>
+#endif
+#include "Vector.h"
+#include "Hash.h"
+#include "HashMap.h"
+#include "Stats.h"
+
+// Read-only map frozen from a built HashMap: a minimal perfect hash (CHD,
+// "hash, displace and compress") over one compact entry array with exactly
+// one slot per key. Keys are first hashed into small displacement buckets
+// (about LAMBDA keys each); every bucket stores one seed that sends all of its
+// keys to free slots. A lookup is one hash, one seed read and one key compare,
+// whether the key is present or not. Extra memory is one uint32_t per bucket.
+template<typename K, typename V, typename Alloc = HeapAllocator, typename Hash = FastHash<K>>
+class PerfectHashMap {
+private:
+    struct Entry {
+        K key;
+        V value;
+    };
+
+    static const size_t LAMBDA = 4;                 // Keys per displacement bucket (on average)
+    static const uint32_t MAX_SEED = 1u << 24;      // Seeds tried per bucket before re-salting
+    static const int MAX_SALTS = 16;
+
+    Vector<Entry, Alloc> slots;
+    Vector<uint32_t, Alloc> seeds;                  // One per displacement bucket
+    uint64_t salt = 0;
+    Hash hasher;
+#ifdef HASHMAP_DEBUG
+    mutable std::atomic<uint64_t> debugLookups{ 0 };
+#endif
+
+    uint64_t keyHash(const K& key) const {
+        return mix64(static_cast<uint64_t>(hasher(key)) ^ salt);
+    }
+
+    // High half of the hash picks the bucket, a reseeded mix of all of it the slot
+    static size_t bucketOf(uint64_t g, size_t bucketCount) {
+        return static_cast<size_t>(((g >> 32) * bucketCount) >> 32);
+    }
+    static size_t slotOf(uint64_t g, uint32_t seed, size_t n) {
+        return static_cast<size_t>(mix64(g + seed * 0x9E3779B97F4A7C15ULL) % n);
+    }
+
+    // One attempt with the current salt; false if some bucket found no seed
+    bool place(const Vector<uint64_t>& g, Vector<uint32_t>& slotOfKey) {
+        const size_t n = g.size();
+        const size_t r = seeds.size();
+
+        // Keys grouped by bucket (counting sort), buckets ordered largest first
+        Vector<uint32_t> start;
+        start.resize(r + 1);
+        for (size_t i = 0; i < n; ++i) ++start[bucketOf(g[i], r) + 1];
+        for (size_t b = 0; b < r; ++b) start[b + 1] += start[b];
+        Vector<uint32_t> members;
+        members.resize(n);
+        Vector<uint32_t> fill;
+        fill.resize(r);
+        for (size_t i = 0; i < n; ++i) {
+            size_t b = bucketOf(g[i], r);
+            members[start[b] + fill[b]++] = static_cast<uint32_t>(i);
+        }
+        Vector<uint32_t> order;
+        order.resize(r);
+        for (size_t b = 0; b < r; ++b) order[b] = static_cast<uint32_t>(b);
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return start[a + 1] - start[a] > start[b + 1] - start[b];
+        });
+
+        Vector<unsigned char> taken;
+        taken.resize(n);
+        Vector<size_t> tried;   // Slots of the bucket being placed
+        for (size_t k = 0; k < r; ++k) {
+            size_t b = order[k];
+            size_t first = start[b], last = start[b + 1];
+            if (first == last) break;    // Only empty buckets left
+            bool placed = false;
+            for (uint32_t seed = 0; seed < MAX_SEED && !placed; ++seed) {
+                tried.clear();
+                placed = true;
+                for (size_t m = first; m < last; ++m) {
+                    size_t s = slotOf(g[members[m]], seed, n);
+                    if (taken[s]) {
+                        placed = false;
+                        break;
+                    }
+                    taken[s] = 1;
+                    tried.push_back(s);
+                }
+                if (!placed) {
+                    for (size_t t = 0; t < tried.size(); ++t) taken[tried[t]] = 0;
+                    continue;
+                }
+                seeds[b] = seed;
+                for (size_t m = first; m < last; ++m) slotOfKey[members[m]] = static_cast<uint32_t>(tried[m - first]);
+            }
+            if (!placed) return false;
+        }
+        return true;
+    }
+
+public:
+    explicit PerfectHashMap(const Alloc& a = Alloc(), const Hash& h = Hash())
+        : slots(a), seeds(a), hasher(h) {}
+
+    PerfectHashMap(const PerfectHashMap&) = delete;
+    PerfectHashMap& operator=(const PerfectHashMap&) = delete;
+
+    // Freeze: take over every entry of 'src' (which is left empty) and build the
+    // perfect hash over them. Throws if no seed assignment is found.
+    template<typename SrcAlloc>
+    void build(HashMap<K, V, SrcAlloc, Hash>& src) {
+        Vector<std::pair<K, V>> items;
+        items.reserve(src.size());
+        src.drain([&](K& key, V& value) {
+            items.push_back(std::pair<K, V>(std::move(key), std::move(value)));
+        });
+
+        const size_t n = items.size();
+        slots.clear();
+        seeds.clear();
+        if (n == 0) return;
+        seeds.resize((n + LAMBDA - 1) / LAMBDA);
+
+        Vector<uint64_t> g;
+        g.resize(n);
+        Vector<uint32_t> slotOfKey;
+        slotOfKey.resize(n);
+        bool ok = false;
+        for (int attempt = 0; attempt < MAX_SALTS && !ok; ++attempt) {
+            salt = mix64(static_cast<uint64_t>(attempt) + 1);
+            for (size_t i = 0; i < n; ++i) g[i] = keyHash(items[i].first);
+            for (size_t b = 0; b < seeds.size(); ++b) seeds[b] = 0;
+            ok = place(g, slotOfKey);
+        }
+        if (!ok) throw std::runtime_error("PerfectHashMap: no perfect hash found");
+
+        slots.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            Entry& e = slots[slotOfKey[i]];
+            e.key = std::move(items[i].first);
+            e.value = std::move(items[i].second);
+        }
+    }
+
+    // Pointer to the value of 'key', or nullptr (one probe either way)
+    V* find(const K& key) {
+        return const_cast<V*>(static_cast<const PerfectHashMap*>(this)->find(key));
+    }
+
+    const V* find(const K& key) const {
+        STATS_COUNT(HashLookups, 1);
+        STATS_COUNT(HashProbes, 1);
+        STATS_MAX(HashChainMax, 1);
+#ifdef HASHMAP_DEBUG
+        debugLookups.fetch_add(1, std::memory_order_relaxed);
+#endif
+        if (slots.empty()) return nullptr;
+        uint64_t g = keyHash(key);
+        const Entry& e = slots[slotOf(g, seeds[bucketOf(g, seeds.size())], slots.size())];
+        return e.key == key ? &e.value : nullptr;
+    }
+
+    size_t size() const { return slots.size(); }
+
+    // Same report as HashMap::inspect: one slot per key, every chain has length 1
+    HashMapStats inspect() const {
+        HashMapStats s;
+        const size_t n = slots.size();
+        s.size = n;
+        s.bucketCount = n;
+        s.usedBuckets = n;
+        s.maxChain = n ? 1 : 0;
+        s.loadFactor = n ? 1.0 : 0.0;
+        s.meanChain = s.loadFactor;
+        s.meanProbesHit = s.loadFactor;
+        s.chainHistogram.resize(2);
+        s.chainHistogram[1] = n;
+        s.memoryBytes = sizeof(*this) + slots.capacity() * sizeof(Entry) + seeds.capacity() * sizeof(uint32_t);
+#ifdef HASHMAP_DEBUG
+        s.lookups = debugLookups.load();
+        s.probes = s.lookups;
+        s.maxProbes = s.lookups ? 1 : 0;
+#endif
+        return s;
+    }
+};
+
+#endif // PERFECTHASHMAP_H
\ No newline at end of file
@@ -0,0 +1,169 @@
+// Range.h
+#ifndef RANGE_H
+#define RANGE_H
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+#include "Span.h"
+
+// Lazy range adaptors. Nothing is copied or allocated while building a pipeline;
+// elements are produced one at a time when the final view is iterated:
+//
+//     auto big = filterView(units, [](const TerritorialUnit* u) { ... });
+//     topN(big, 20, byPopulation, best);   // The 20 smallest matches, sorted
+//
+// Views hold their source by value, so the source must be a view itself or a
+// container that outlives the pipeline (containers are wrapped in a Span).
+
+// Marker base for adaptor types, so they are stored by value and not wrapped in a Span
+struct ViewBase {};
+
+// Containers (Vector, SmallVector, Span) are viewed through a Span over their storage
+template<typename R, typename = void>
+struct ViewOf {
+    using type = Span<typename std::remove_reference<decltype(*std::declval<R&>().begin())>::type>;
+    static type make(R& r) { return type(r.data(), r.size()); }
+};
+
+// Adaptors are copied as they are
+template<typename R>
+struct ViewOf<R, typename std::enable_if<std::is_base_of<ViewBase, typename std::decay<R>::type>::value>::type> {
+    using type = typename std::decay<R>::type;
+    static type make(const R& r) { return r; }
+};
+
+template<typename R>
+using ViewType = typename ViewOf<typename std::remove_reference<R>::type>::type;
+
+template<typename R>
+ViewType<R> asView(R&& r) {
+    return ViewOf<typename std::remove_reference<R>::type>::make(r);
+}
+
+// === filterView: elements for which pred(x) is true ===
+template<typename V, typename Pred>
+class FilterView : public ViewBase {
+private:
+    V base;
+    Pred pred;
+    using BaseIter = decltype(std::declval<const V&>().begin());
+
+public:
+    class iterator {
+    private:
+        BaseIter cur, last;
+        const Pred* pred;
+
+        void skip() {
+            while (cur != last && !(*pred)(*cur)) ++cur;
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename std::iterator_traits<BaseIter>::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = typename std::iterator_traits<BaseIter>::pointer;
+        using reference = typename std::iterator_traits<BaseIter>::reference;
+
+        iterator(BaseIter c, BaseIter l, const Pred* p) : cur(c), last(l), pred(p) { skip(); }
+
+        reference operator*() const { return *cur; }
+        iterator& operator++() {
+            ++cur;
+            skip();
+            return *this;
+        }
+        bool operator==(const iterator& o) const { return cur == o.cur; }
+        bool operator!=(const iterator& o) const { return cur != o.cur; }
+    };
+
+    FilterView(V v, Pred p) : base(std::move(v)), pred(std::move(p)) {}
+
+    iterator begin() const { return iterator(base.begin(), base.end(), &pred); }
+    iterator end() const { return iterator(base.end(), base.end(), &pred); }
+};
+
+// === transformView: fn(x) for every element (computed on dereference) ===
+template<typename V, typename Fn>
+class TransformView : public ViewBase {
+private:
+    V base;
+    Fn fn;
+    using BaseIter = decltype(std::declval<const V&>().begin());
+
+public:
+    class iterator {
+    private:
+        BaseIter cur;
+        const Fn* fn;
+
+    public:
+        using value_type = typename std::decay<decltype((*fn)(*cur))>::type;
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = value_type;
+
+        iterator(BaseIter c, const Fn* f) : cur(c), fn(f) {}
+
+        value_type operator*() const { return (*fn)(*cur); }
+        iterator& operator++() {
+            ++cur;
+            return *this;
+        }
+        bool operator==(const iterator& o) const { return cur == o.cur; }
+        bool operator!=(const iterator& o) const { return cur != o.cur; }
+    };
+
+    TransformView(V v, Fn f) : base(std::move(v)), fn(std::move(f)) {}
+
+    iterator begin() const { return iterator(base.begin(), &fn); }
+    iterator end() const { return iterator(base.end(), &fn); }
+};
+
+template<typename R, typename Pred>
+FilterView<ViewType<R>, Pred> filterView(R&& r, Pred pred) {
+    return FilterView<ViewType<R>, Pred>(asView(r), pred);
+}
+
+template<typename R, typename Fn>
+TransformView<ViewType<R>, Fn> transformView(R&& r, Fn fn) {
+    return TransformView<ViewType<R>, Fn>(asView(r), fn);
+}
+
+// === Sinks ===
+
+// Append every element of the range to "out" (a Vector or SmallVector)
+template<typename R, typename Out>
+void collect(const R& r, Out& out) {
+    for (auto it = r.begin(); it != r.end(); ++it) {
+        out.push_back(*it);
+    }
+}
+
+// Keep only the n smallest elements of the range (by "less") in "out", sorted.
+// Uses a bounded heap, so at most n elements are ever held at once.
+// "out" must be empty. Ties follow "less" alone: a strict total order (RankLess
+// breaks equal keys by unit id) gives one deterministic result.
+template<typename R, typename Less, typename Out>
+void topN(const R& r, size_t n, Less less, Out& out) {
+    if (n == 0) return;
+    for (auto it = r.begin(); it != r.end(); ++it) {
+        if (out.size() < n) {
+            out.push_back(*it);
+            std::push_heap(out.begin(), out.end(), less);
+        }
+        else if (less(*it, out[0])) {
+            // Replace the current largest of the kept elements
+            std::pop_heap(out.begin(), out.end(), less);
+            out[out.size() - 1] = *it;
+            std::push_heap(out.begin(), out.end(), less);
+        }
+    }
+    std::sort_heap(out.begin(), out.end(), less);
+}
+
+#endif // RANGE_H
@@ -0,0 +1,201 @@
+// ResultWriter.h
+#ifndef RESULTWRITER_H
+#define RESULTWRITER_H
+
+#include <cstddef>
+#include <charconv>
+#include <ostream>
+#include <string>
+
+// Output formats for query results
+enum class OutputFormat { Text, Csv, Jsonl };
+
+// "text", "csv" or "jsonl" (false for anything else)
+inline bool parseOutputFormat(const std::string& s, OutputFormat& fmt) {
+    if (s == "text")  fmt = OutputFormat::Text;
+    else if (s == "csv")   fmt = OutputFormat::Csv;
+    else if (s == "jsonl") fmt = OutputFormat::Jsonl;
+    else return false;
+    return true;
+}
+
+// Buffered result output. Text and numbers are formatted straight into one
+// reusable buffer (numbers with std::to_chars: no locale, no stream state) and
+// reach the sink in large writes once 'flushAt' bytes have collected.
+// Without a sink the writer only accumulates; read it back with buffer().
+//
+// Free text is written with operator<<, like an ostream. Tabular results in
+// Csv/Jsonl format are written as records with beginRecord()/field()/endRecord(),
+// one line per record; CSV writes a header line whenever the columns change.
+class ResultWriter {
+private:
+    std::ostream* sink;
+    std::string buf;
+    size_t flushAt;
+    OutputFormat fmt;
+    std::string columns;       // CSV: column names of the record being written
+    std::string lastColumns;   // CSV: header written most recently
+    size_t recordStart = 0;    // Offset of the current record in buf
+    bool firstField = true;
+
+    void appendInt(long long v) {
+        char tmp[24];
+        std::to_chars_result r = std::to_chars(tmp, tmp + sizeof(tmp), v);
+        buf.append(tmp, static_cast<size_t>(r.ptr - tmp));
+    }
+
+    void appendUnsigned(unsigned long long v) {
+        char tmp[24];
+        std::to_chars_result r = std::to_chars(tmp, tmp + sizeof(tmp), v);
+        buf.append(tmp, static_cast<size_t>(r.ptr - tmp));
+    }
+
+    // Same digits as an ostream with its default precision (%g, 6 digits)
+    void appendDouble(double v) {
+        char tmp[32];
+        std::to_chars_result r = std::to_chars(tmp, tmp + sizeof(tmp), v, std::chars_format::general, 6);
+        buf.append(tmp, static_cast<size_t>(r.ptr - tmp));
+    }
+
+    // CSV cell, quoted only when it contains a separator, quote or line break
+    void appendCsv(const std::string& s) {
+        if (s.find_first_of(",\"\r\n") == std::string::npos) {
+            buf += s;
+            return;
+        }
+        buf += '"';
+        for (char c : s) {
+            if (c == '"') buf += '"';
+            buf += c;
+        }
+        buf += '"';
+    }
+
+    // JSON string literal (UTF-8 passes through unchanged)
+    void appendJson(const std::string& s) {
+        static const char HEX[] = "0123456789abcdef";
+        buf += '"';
+        for (char ch : s) {
+            unsigned char c = static_cast<unsigned char>(ch);
+            if (c == '"' || c == '\\') {
+                buf += '\\';
+                buf += ch;
+            }
+            else if (c == '\n') buf += "\\n";
+            else if (c == '\r') buf += "\\r";
+            else if (c == '\t') buf += "\\t";
+            else if (c < 0x20) {
+                buf += "\\u00";
+                buf += HEX[c >> 4];
+                buf += HEX[c & 15];
+            }
+            else buf += ch;
+        }
+        buf += '"';
+    }
+
+    // Separator and (JSON) key in front of a field value
+    void fieldPrefix(const char* name) {
+        if (fmt == OutputFormat::Csv) {
+            if (!firstField) {
+                buf += ',';
+                columns += ',';
+            }
+            columns += name;
+        }
+        else {
+            if (!firstField) buf += ',';
+            buf += '"';
+            buf += name;
+            buf += "\":";
+        }
+        firstField = false;
+    }
+
+    void maybeFlush() {
+        if (sink && buf.size() >= flushAt) flush();
+    }
+
+public:
+    // Writes to 'out' in chunks of about 'flushBytes'
+    explicit ResultWriter(std::ostream& out, OutputFormat f = OutputFormat::Text, size_t flushBytes = 1 << 20)
+        : sink(&out), flushAt(flushBytes), fmt(f) {
+        buf.reserve(flushBytes < (1 << 16) ? flushBytes : (1 << 16));
+    }
+
+    // Accumulates everything in memory
+    explicit ResultWriter(OutputFormat f = OutputFormat::Text)
+        : sink(nullptr), flushAt(0), fmt(f) {}
+
+    ~ResultWriter() { flush(); }
+
+    ResultWriter(const ResultWriter&) = delete;
+    ResultWriter& operator=(const ResultWriter&) = delete;
+
+    OutputFormat format() const { return fmt; }
+    bool isText() const { return fmt == OutputFormat::Text; }
+    void setFormat(OutputFormat f) {
+        fmt = f;
+        lastColumns.clear();
+    }
+
+    // The next CSV record starts a new table (header written again)
+    void newResultSet() { lastColumns.clear(); }
+
+    // Hand everything buffered to the sink
+    void flush() {
+        if (!sink || buf.empty()) return;
+        sink->write(buf.data(), static_cast<std::streamsize>(buf.size()));
+        buf.clear();
+    }
+
+    // Without a sink: the text written so far
+    const std::string& buffer() const { return buf; }
+    void clear() { buf.clear(); }
+
+    // === Free text ===
+    ResultWriter& operator<<(const std::string& s) { buf += s; maybeFlush(); return *this; }
+    ResultWriter& operator<<(const char* s) { buf += s; maybeFlush(); return *this; }
+    ResultWriter& operator<<(char c) { buf += c; return *this; }
+    ResultWriter& operator<<(int v) { appendInt(v); return *this; }
+    ResultWriter& operator<<(long v) { appendInt(v); return *this; }
+    ResultWriter& operator<<(long long v) { appendInt(v); return *this; }
+    ResultWriter& operator<<(unsigned v) { appendUnsigned(v); return *this; }
+    ResultWriter& operator<<(unsigned long v) { appendUnsigned(v); return *this; }
+    ResultWriter& operator<<(unsigned long long v) { appendUnsigned(v); return *this; }
+    ResultWriter& operator<<(double v) { appendDouble(v); return *this; }
+
+    // === Records (Csv / Jsonl) ===
+    void beginRecord() {
+        recordStart = buf.size();
+        columns.clear();
+        firstField = true;
+        if (fmt == OutputFormat::Jsonl) buf += '{';
+    }
+
+    void field(const char* name, const std::string& v) {
+        fieldPrefix(name);
+        if (fmt == OutputFormat::Csv) appendCsv(v);
+        else appendJson(v);
+    }
+    void field(const char* name, const char* v) { field(name, std::string(v)); }
+    void field(const char* name, int v) { fieldPrefix(name); appendInt(v); }
+    void field(const char* name, long long v) { fieldPrefix(name); appendInt(v); }
+    void field(const char* name, size_t v) { fieldPrefix(name); appendUnsigned(v); }
+    void field(const char* name, double v) { fieldPrefix(name); appendDouble(v); }
+
+    void endRecord() {
+        if (fmt == OutputFormat::Jsonl) {
+            buf += '}';
+        }
+        else if (columns != lastColumns) {
+            // Header goes in front of the record that introduced the columns
+            buf.insert(recordStart, columns + "\n");
+            lastColumns = columns;
+        }
+        buf += '\n';
+        maybeFlush();
+    }
+};
+
+#endif // RESULTWRITER_H
\ No newline at end of file
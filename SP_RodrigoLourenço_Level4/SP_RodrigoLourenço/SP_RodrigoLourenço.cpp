@@ -7,22 +7,215 @@
 #include <cctype>           // For character classification (std::tolower)
 #include <stdexcept>        // For std::runtime_error
 #include <limits>           // For std::numeric_limits
-#include <functional>       // For std::function
 #include <locale>           // For locale and collation
-#define _CRTDBG_MAP_ALLOC    // Enable memory leak detection on Windows
+#include <cstdint>          // For uint32_t row indices
+#include <memory>           // For std::shared_ptr (cached flat years)
+#include <chrono>           // For batch query timing
+#include <algorithm>        // For std::sort (latency percentiles)
+#include <climits>          // For INT_MIN / INT_MAX
+#include <cmath>            // For std::pow (growth rates)
+#include <atomic>           // For the allocation counters
+#include <new>              // For std::bad_alloc
 #include <cstdlib>          // For general utilities
-#include <crtdbg.h>         // For heap debug routines
+#include <cstring>          // For std::memcpy (frame headers)
+#include <thread>           // For the server worker pool
+#include <mutex>            // For std::mutex / std::lock_guard
+#include <shared_mutex>     // For std::shared_mutex (updates vs. queries)
+#include <condition_variable> // For the worker job queue
+#include <deque>            // For the worker job queue
+#ifdef _MSC_VER
+#  define _CRTDBG_MAP_ALLOC  // Enable memory leak detection on Windows
+#  include <crtdbg.h>       // For heap debug routines
+#endif
 
 #ifdef _WIN32
 #  ifndef NOMINMAX
 #    define NOMINMAX        // Prevent Windows headers from defining min/max macros
 #  endif
 #  include <Windows.h>      // For SetConsoleCP / SetConsoleOutputCP on Windows
+#  include <psapi.h>        // For GetProcessMemoryInfo (peak working set)
+#endif
+
+#ifdef __linux__
+#  include <sys/socket.h>   // For the query server (Unix domain sockets)
+#  include <sys/un.h>
+#  include <sys/epoll.h>
+#  include <sys/eventfd.h>
+#  include <unistd.h>
+#  include <csignal>
+#  include <cerrno>
 #endif
 
+#include "Allocator.h"
 #include "Vector.h"       
+#include "SmallVector.h"
+#include "Span.h"
+#include "Range.h"
 #include "Map.h"          
 #include "HashMap.h"       
+#include "PerfectHashMap.h"
+#include "ThreadPool.h"
+#include "ResultWriter.h"
+#include "SortedIndex.h"
+#include "FenwickTree.h"
+#include "PackedColumns.h"
+#include "Stats.h"
+
+// === Allocation counters ===
+// Every global operator new is counted so "--alloc-stats" can compare the
+// arena build against the plain heap build (std::string, std::map, ... included).
+// The whole replaceable set is defined (scalar and array, sized, nothrow and
+// over-aligned), so every new is paired with the matching delete below.
+static std::atomic<size_t> g_newCalls{ 0 };
+static std::atomic<size_t> g_newBytes{ 0 };
+
+static void* countedAlloc(std::size_t n) noexcept {
+    g_newCalls.fetch_add(1, std::memory_order_relaxed);
+    g_newBytes.fetch_add(n, std::memory_order_relaxed);
+    return std::malloc(n ? n : 1);
+}
+
+static void* countedAlignedAlloc(std::size_t n, std::align_val_t al) noexcept {
+    g_newCalls.fetch_add(1, std::memory_order_relaxed);
+    g_newBytes.fetch_add(n, std::memory_order_relaxed);
+    std::size_t align = static_cast<std::size_t>(al);
+#ifdef _WIN32
+    return _aligned_malloc(n ? n : 1, align);
+#else
+    void* p = nullptr;
+    if (align < sizeof(void*)) align = sizeof(void*);
+    return posix_memalign(&p, align, n ? n : 1) == 0 ? p : nullptr;
+#endif
+}
+
+// Out of line on purpose: inlined into operator delete, GCC pairs the free()
+// with the caller's new-expression and reports a mismatched new/delete
+#ifdef _MSC_VER
+#  define SP_NOINLINE __declspec(noinline)
+#else
+#  define SP_NOINLINE __attribute__((noinline))
+#endif
+
+SP_NOINLINE static void heapFree(void* p) noexcept { std::free(p); }
+
+SP_NOINLINE static void alignedFree(void* p) noexcept {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void* operator new(std::size_t n) {
+    if (void* p = countedAlloc(n)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t n) {
+    if (void* p = countedAlloc(n)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept { return countedAlloc(n); }
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept { return countedAlloc(n); }
+void* operator new(std::size_t n, std::align_val_t al) {
+    if (void* p = countedAlignedAlloc(n, al)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t n, std::align_val_t al) {
+    if (void* p = countedAlignedAlloc(n, al)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t n, std::align_val_t al, const std::nothrow_t&) noexcept { return countedAlignedAlloc(n, al); }
+void* operator new[](std::size_t n, std::align_val_t al, const std::nothrow_t&) noexcept { return countedAlignedAlloc(n, al); }
+
+void operator delete(void* p) noexcept { heapFree(p); }
+void operator delete[](void* p) noexcept { heapFree(p); }
+void operator delete(void* p, std::size_t) noexcept { heapFree(p); }
+void operator delete[](void* p, std::size_t) noexcept { heapFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { heapFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { heapFree(p); }
+void operator delete(void* p, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { alignedFree(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { alignedFree(p); }
+
+// === Phase measurements ===
+// Peak resident set size in KB: since the last resetPeakRss() on Linux,
+// since process start on Windows (0 where neither is available)
+static size_t peakRssKb() {
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) return std::strtoul(line.c_str() + 6, nullptr, 10);
+    }
+    return 0;
+#elif defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+    return pmc.PeakWorkingSetSize / 1024;
+#else
+    return 0;
+#endif
+}
+
+// Start a new peak-RSS window (Linux: "5" to clear_refs resets VmHWM to the current RSS)
+static void resetPeakRss() {
+#ifdef __linux__
+    std::ofstream clear("/proc/self/clear_refs");
+    if (clear) clear << "5";
+#endif
+}
+
+// Wall time, peak RSS and operator-new traffic of one named phase
+struct PhaseSample {
+    std::string name;
+    double ms = 0.0;
+    size_t peakRssKb = 0;
+    size_t allocs = 0;
+    size_t allocBytes = 0;
+    size_t ops = 0;           // Queries run in the phase (0 for load phases)
+};
+
+// Samples of consecutive phases; a Scope measures from construction to destruction.
+// A Scope on a null log measures nothing, so code paths can be timed optionally.
+class PhaseLog {
+private:
+    Vector<PhaseSample> samples;
+
+public:
+    class Scope {
+    private:
+        PhaseLog* log;
+        PhaseSample sample;
+        std::chrono::steady_clock::time_point start;
+        size_t calls0 = 0, bytes0 = 0;
+
+    public:
+        Scope(PhaseLog* l, const char* name, size_t ops = 0) : log(l) {
+            if (!log) return;
+            sample.name = name;
+            sample.ops = ops;
+            resetPeakRss();
+            calls0 = g_newCalls.load();
+            bytes0 = g_newBytes.load();
+            start = std::chrono::steady_clock::now();
+        }
+        ~Scope() {
+            if (!log) return;
+            sample.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            sample.allocs = g_newCalls.load() - calls0;
+            sample.allocBytes = g_newBytes.load() - bytes0;
+            sample.peakRssKb = peakRssKb();
+            log->samples.push_back(sample);
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    const Vector<PhaseSample>& all() const { return samples; }
+};
 
 // === Level 1 flat-data structures & functions ===
 struct FlatMunicipality {
@@ -43,16 +236,17 @@ static std::string cleanCode(const std::string& s) {
     return out;
 }
 
-// Load one year's CSV file into a Vector<FlatMunicipality>
-static void loadFlat(const std::string& fn, Vector<FlatMunicipality>& out) {
+// Load one year's CSV file into a Vector<FlatMunicipality> (false if the file cannot be opened)
+static bool loadFlat(const std::string& fn, Vector<FlatMunicipality>& out) {
     std::ifstream f(fn);              // Open file named 'fn'
     if (!f) {
         std::cerr << "[loadFlat] Could not open " << fn << "\n";
-        return;                       
+        return false;
     }
     std::string line;
     std::getline(f, line);          
     while (std::getline(f, line)) {
+        STATS_COUNT(BytesRead, line.size() + 1);
         if (line.empty()) continue;    // Skip empty lines
         std::istringstream ss(line);   
         FlatMunicipality m;
@@ -64,11 +258,22 @@ static void loadFlat(const std::string& fn, Vector<FlatMunicipality>& out) {
         std::getline(ss, tmp, ';'); m.female = std::stoi(tmp); // Read female count
         out.push_back(m);                       // Add entry Vector
     }
+    return true;
 }
 
-// Print one FlatMunicipality record to console
-static void printFlat(const FlatMunicipality& m) {
-    std::cout << "Name: " << m.name
+// Print one FlatMunicipality record (to the console by default)
+static void printFlat(const FlatMunicipality& m, ResultWriter& out) {
+    if (!out.isText()) {
+        out.beginRecord();
+        out.field("name", m.name);
+        out.field("code", m.code);
+        out.field("male", m.male);
+        out.field("female", m.female);
+        out.field("total", m.male + m.female);
+        out.endRecord();
+        return;
+    }
+    out << "Name: " << m.name
         << ", Code: " << m.code
         << ", Male=" << m.male
         << ", Female=" << m.female
@@ -76,17 +281,103 @@ static void printFlat(const FlatMunicipality& m) {
         << "\n";
 }
 
-// Generic filter function for any Vector<T> using a predicate
-template<typename T, typename Pred>
-static Vector<T> filter(const Vector<T>& data, Pred pred) {
-    Vector<T> result;                     
-    for (size_t i = 0; i < data.size(); ++i) {
-        if (pred(data[i])) {              
-            result.push_back(data[i]);   
+// One parsed year file plus its rows sorted by total population
+struct FlatYear {
+    Vector<FlatMunicipality> rows;
+    SortedIndex<int> byTotal;     // (male + female, row)
+};
+
+// Rows whose total population is within [lo, hi], found by binary search.
+// With 'popOrder' they come in population order, otherwise in file order.
+static Vector<uint32_t> flatRange(const FlatYear& fy, int lo, int hi, bool popOrder) {
+    Span<const SortedIndex<int>::Entry> hits = fy.byTotal.between(lo, hi);
+    Vector<uint32_t> rows;
+    rows.reserve(hits.size());
+    for (size_t i = 0; i < hits.size(); ++i) rows.push_back(hits[i].row);
+    if (!popOrder) std::sort(rows.begin(), rows.end());
+    return rows;
+}
+
+// LRU cache of parsed year files, so repeated Level 1 queries never re-read the CSV.
+// Entries are shared and immutable: a query keeps its year alive even if it gets evicted.
+class FlatCache {
+public:
+    using Rows = std::shared_ptr<const FlatYear>;
+
+private:
+    struct Entry {
+        std::string year;
+        Rows rows;
+        size_t lastUse = 0;   // Tick of the most recent access (for LRU eviction)
+    };
+
+    Vector<Entry> entries;
+    size_t capacity;
+    std::string directory;    // Prefix of the YYYY.csv paths ("" = working directory)
+    mutable std::mutex mtx;   // Server workers share one cache
+    size_t tick = 0;
+    size_t hitCount = 0;
+    size_t missCount = 0;
+
+public:
+    explicit FlatCache(size_t maxYears) : capacity(maxYears > 0 ? maxYears : 1) {}
+
+    void setDirectory(const std::string& dir) { directory = dir; }
+
+    // Rows of "year", parsing YYYY.csv only on the first request (empty if the file is missing)
+    Rows get(const std::string& year) {
+        std::lock_guard<std::mutex> lock(mtx);
+        ++tick;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (entries[i].year == year) {
+                ++hitCount;
+                entries[i].lastUse = tick;
+                return entries[i].rows;
+            }
+        }
+
+        ++missCount;
+        std::shared_ptr<FlatYear> rows = std::make_shared<FlatYear>();
+        if (!loadFlat(directory + year + ".csv", rows->rows)) {
+            return rows;              // Do not cache a missing file, it may appear later
+        }
+        for (size_t i = 0; i < rows->rows.size(); ++i) {
+            const FlatMunicipality& m = rows->rows[i];
+            rows->byTotal.add(m.male + m.female, static_cast<uint32_t>(i));
         }
+        rows->byTotal.finish();
+
+        Entry e;
+        e.year = year;
+        e.rows = rows;
+        e.lastUse = tick;
+        if (entries.size() < capacity) {
+            entries.push_back(std::move(e));
+        }
+        else {
+            // Replace the least recently used year
+            size_t lru = 0;
+            for (size_t i = 1; i < entries.size(); ++i) {
+                if (entries[i].lastUse < entries[lru].lastUse) lru = i;
+            }
+            entries[lru] = std::move(e);
+        }
+        return rows;
     }
-    return result;
-}
+
+    size_t hits() const { return hitCount; }
+    size_t misses() const { return missCount; }
+    size_t cachedYears() const { return entries.size(); }
+
+    void printStats() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        size_t total = hitCount + missCount;
+        std::cout << "\n[Flat cache] years cached=" << entries.size() << "/" << capacity
+            << ", hits=" << hitCount
+            << ", misses=" << missCount
+            << ", hit ratio=" << (total ? (100 * hitCount / total) : 0) << "%\n";
+    }
+};
 
 // === Years of data ===
 static const Vector<std::string> YEARS = []() {
@@ -100,29 +391,290 @@ static const Vector<std::string> YEARS = []() {
 }();
 
 // === Level 2 hierarchy definitions ===
+struct PopColumns;
+
 // Structure to hold a territorial unit's data in the hierarchy (name, code, type, population map)
 struct TerritorialUnit {
     std::string name;   // Name of the unit (Country/GeoDiv/State/Region/Municipality)
     std::string code;   // Code (AT, AT1)
     std::string type;   // Type: "Country", "GeoDiv", "State", "Region", "Municipality"
     Map<std::string, std::pair<int, int>> popByYear;
+    uint32_t id = 0;    // Position in the DFS order = row in the population columns
+    const PopColumns* packedPop = nullptr;  // --compress: popByYear is released, populations are read from here
 };
 
+// Allocator for everything that makes up the loaded dataset (nodes, child lists, tables).
+// Binds to the arena made current by "--arena", otherwise it is the plain heap.
+using DataAlloc = ArenaAllocator;
+
 // Node in the hierarchy tree, holding a TerritorialUnit and pointers to children/parent
 struct HierarchyNode {
     TerritorialUnit unit;                // Data for this node
-    Vector<HierarchyNode*> children;     // Vector of pointers to child nodes
+    SmallVector<HierarchyNode*, 1, DataAlloc> children; // Child pointers, sized once at load (first one inline)
     HierarchyNode* parent = nullptr;     // Pointer to parent node (nullptr for root)
+    size_t dfsBegin = 0;                 // This subtree occupies [dfsBegin, dfsEnd) of the DFS order
+    size_t dfsEnd = 0;
+    bool inArena = false;                // Memory belongs to a MonotonicArena (never deleted one by one)
 
     HierarchyNode(const TerritorialUnit& u) : unit(u) {}
     ~HierarchyNode() {
         // Recursively delete all children to avoid memory leaks
         for (size_t i = 0; i < children.size(); ++i) {
-            delete children[i];
+            destroy(children[i]);
+        }
+    }
+
+    // Create a node in the current arena (or on the heap when there is none)
+    static HierarchyNode* create(const TerritorialUnit& u) {
+        MonotonicArena* arena = MonotonicArena::current();
+        if (!arena) return new HierarchyNode(u);
+        HierarchyNode* n = new (arena->allocate(sizeof(HierarchyNode), alignof(HierarchyNode))) HierarchyNode(u);
+        n->inArena = true;
+        return n;
+    }
+
+    // Destroy a node (and its subtree); arena memory is only returned by MonotonicArena::release()
+    static void destroy(HierarchyNode* n) {
+        if (n->inArena) n->~HierarchyNode();
+        else delete n;
+    }
+};
+
+// Dataset containers: code → node lookup and name → nodes search tables
+using NodeLookup = HashMap<std::string, HierarchyNode*, DataAlloc>;
+using NodeList = Vector<HierarchyNode*, DataAlloc>;
+using NameTable = HashMap<std::string, NodeList, DataAlloc>;
+using CodeIndex = PerfectHashMap<std::string, HierarchyNode*, DataAlloc>;   // Frozen NodeLookup
+using NameIndex = PerfectHashMap<std::string, NodeList, DataAlloc>;         // Frozen NameTable
+
+// === Query predicates & comparators ===
+// Plain functors instead of std::function, so every filter/sort loop is compiled
+// for its exact predicate and nothing is copied or allocated per row.
+
+// Male/female/total population of a unit for one year (0 when there is no data)
+enum class Sex { Male, Female, Total };
+
+static Sex parseSex(const std::string& s) {
+    if (s == "male")   return Sex::Male;
+    if (s == "female") return Sex::Female;
+    return Sex::Total;
+}
+
+static int packedPopulation(const PopColumns& cols, uint32_t row, const std::string& yr, Sex sex);
+
+static int unitPopulation(const TerritorialUnit& u, const std::string& yr, Sex sex = Sex::Total) {
+    if (u.packedPop) return packedPopulation(*u.packedPop, u.id, yr, sex);
+    auto it = u.popByYear.find(yr);
+    if (it == u.popByYear.end()) return 0;
+    int m = it->second.first;
+    int f = it->second.second;
+    return (sex == Sex::Male ? m : (sex == Sex::Female ? f : (m + f)));
+}
+
+// Case-insensitive substring match on the name; compares in place instead of
+// building a lower-case copy of every name
+struct NameContains {
+    std::string needle;   // Lower-case
+
+    explicit NameContains(const std::string& sub) : needle(sub) {
+        for (size_t i = 0; i < needle.size(); ++i) {
+            needle[i] = std::tolower(static_cast<unsigned char>(needle[i]));
+        }
+    }
+
+    template<typename Row>
+    bool operator()(const Row& r) const {
+        const std::string& hay = r.name;
+        size_t n = needle.size();
+        if (n > hay.size()) return false;
+        for (size_t i = 0; i + n <= hay.size(); ++i) {
+            size_t j = 0;
+            while (j < n && std::tolower(static_cast<unsigned char>(hay[i + j])) == static_cast<unsigned char>(needle[j])) {
+                ++j;
+            }
+            if (j == n) return true;
         }
+        return false;
+    }
+};
+
+// Only units of one type ("Municipality", "Region", ...); an empty type matches everything
+struct TypeIs {
+    std::string type;
+    explicit TypeIs(const std::string& t) : type(t) {}
+    bool operator()(const TerritorialUnit& u) const { return type.empty() || u.type == type; }
+};
+
+// lo ≤ total population ≤ hi (either bound may be left open)
+struct PopulationBetween {
+    std::string year;
+    int lo;
+    int hi;
+    PopulationBetween(const std::string& y, int l, int h) : year(y), lo(l), hi(h) {}
+    template<typename Row>
+    bool operator()(const Row& r) const {
+        if (lo == INT_MIN && hi == INT_MAX) return true;
+        int tot = unitPopulation(r, year);
+        return tot >= lo && tot <= hi;
+    }
+};
+
+// Total population ≤ thr (max filter)
+struct PopulationAtMost {
+    std::string year;
+    int thr;
+    PopulationAtMost(const std::string& y, int t) : year(y), thr(t) {}
+    template<typename Row>
+    bool operator()(const Row& r) const { return unitPopulation(r, year) <= thr; }
+};
+
+// Total population ≥ thr (min filter)
+struct PopulationAtLeast {
+    std::string year;
+    int thr;
+    PopulationAtLeast(const std::string& y, int t) : year(y), thr(t) {}
+    template<typename Row>
+    bool operator()(const Row& r) const { return unitPopulation(r, year) >= thr; }
+};
+
+// Conjunction of a batch of predicates, evaluated left to right with short-circuit
+template<typename... Preds>
+struct AllOf;
+
+template<>
+struct AllOf<> {
+    template<typename Row>
+    bool operator()(const Row&) const { return true; }
+};
+
+template<typename P, typename... Rest>
+struct AllOf<P, Rest...> {
+    P first;
+    AllOf<Rest...> rest;
+    AllOf(const P& p, const Rest&... r) : first(p), rest(r...) {}
+    template<typename Row>
+    bool operator()(const Row& row) const { return first(row) && rest(row); }
+};
+
+template<typename... Preds>
+static AllOf<Preds...> allOf(const Preds&... preds) {
+    return AllOf<Preds...>(preds...);
+}
+
+// Alphabetical order using the environment's collation (diacritics aware)
+struct ByName {
+    std::locale loc;
+    const std::collate<char>* coll;
+    explicit ByName(const std::locale& l) : loc(l), coll(&std::use_facet<std::collate<char>>(loc)) {}
+    int operator()(const TerritorialUnit& a, const TerritorialUnit& b) const {
+        STATS_COUNT(Comparisons, 1);
+        int r = coll->compare(a.name.data(), a.name.data() + a.name.size(),
+            b.name.data(), b.name.data() + b.name.size());
+        return (r < 0 ? -1 : (r > 0 ? 1 : 0));
+    }
+};
+
+// Population order for a given year and sex
+struct ByPopulation {
+    std::string year;
+    Sex sex;
+    ByPopulation(const std::string& y, Sex s) : year(y), sex(s) {}
+    int operator()(const TerritorialUnit& a, const TerritorialUnit& b) const {
+        STATS_COUNT(Comparisons, 1);
+        int va = unitPopulation(a, year, sex);
+        int vb = unitPopulation(b, year, sex);
+        return (va < vb ? -1 : (va > vb ? 1 : 0));
+    }
+};
+
+// === Intra-query parallelism ===
+// Scans are cut into morsels of MORSEL_ROWS rows that the pool's workers steal
+// from each other; sorts hand out runs of the same size. Inputs smaller than
+// PARALLEL_MIN_ROWS stay on the calling thread, where the task overhead would
+// cost more than it saves.
+static const size_t MORSEL_ROWS = 4096;
+static const size_t PARALLEL_MIN_ROWS = 16384;
+
+// Pool for an operator over n rows (nullptr: run sequentially)
+static ThreadPool* poolFor(size_t n) {
+    return n >= PARALLEL_MIN_ROWS ? ThreadPool::current() : nullptr;
+}
+
+// Selection vector: indices of the rows of 'data' that pass every predicate
+template<typename Container, typename... Preds>
+static Vector<uint32_t> selectRows(const Container& data, const Preds&... preds) {
+    AllOf<Preds...> pred(preds...);
+    return parallelCollect<uint32_t>(poolFor(data.size()), data.size(), MORSEL_ROWS,
+        [&](size_t lo, size_t hi, Vector<uint32_t>& rows) {
+            for (size_t i = lo; i < hi; ++i) {
+                if (pred(data[i])) {
+                    rows.push_back(static_cast<uint32_t>(i));
+                }
+            }
+        });
+}
+
+// Selection vector over a node range: pointers to the units that pass every predicate
+template<typename... Preds>
+static Vector<const TerritorialUnit*> selectUnits(Span<HierarchyNode* const> nodes, const Preds&... preds) {
+    AllOf<Preds...> pred(preds...);
+    return parallelCollect<const TerritorialUnit*>(poolFor(nodes.size()), nodes.size(), MORSEL_ROWS,
+        [&](size_t lo, size_t hi, Vector<const TerritorialUnit*>& out) {
+            auto units = transformView(nodes.subspan(lo, hi - lo),
+                [](HierarchyNode* n) { return static_cast<const TerritorialUnit*>(&n->unit); });
+            collect(filterView(units, [&](const TerritorialUnit* u) { return pred(*u); }), out);
+        });
+}
+
+// Stable sort of a selection vector (parallel merge sort on large inputs); only pointers move
+template<typename Cmp>
+static void sortUnits(Vector<const TerritorialUnit*>& units, const Cmp& cmp) {
+    parallelMergeSort(poolFor(units.size()), units.data(), units.size(),
+        [&](const TerritorialUnit* a, const TerritorialUnit* b) { return cmp(*a, *b) < 0; },
+        MORSEL_ROWS);
+}
+
+// Strict order for topN: 'cmp', ties by DFS position (what a stable sort of a
+// DFS-ordered selection gives); 'desc' reverses both
+template<typename Cmp>
+struct RankLess {
+    const Cmp& cmp;
+    bool desc;
+    bool operator()(const TerritorialUnit* a, const TerritorialUnit* b) const {
+        if (desc) std::swap(a, b);
+        int c = cmp(*a, *b);
+        return c < 0 || (c == 0 && a->id < b->id);
     }
 };
 
+// Order a DFS-ordered selection by 'cmp' (order=desc: reversed) and keep the
+// first 'top' (0 = all). A limit picks the rows with a bounded heap, O(n log top),
+// instead of sorting every match.
+template<typename Cmp>
+static void rankUnits(Vector<const TerritorialUnit*>& units, const Cmp& cmp, bool desc, size_t top) {
+    if (top > 0 && top < units.size()) {
+        Vector<const TerritorialUnit*> best;
+        topN(units, top, RankLess<Cmp>{ cmp, desc }, best);
+        units = std::move(best);
+        return;
+    }
+    sortUnits(units, cmp);
+    if (desc) std::reverse(units.begin(), units.end());
+}
+
+// filter → sort → top as one pass over a node range: the matches stream into
+// topN's bounded heap, so only 'top' of them are ever held
+template<typename Cmp, typename... Preds>
+static Vector<const TerritorialUnit*> selectTopUnits(Span<HierarchyNode* const> nodes, const Cmp& cmp,
+    bool desc, size_t top, const Preds&... preds)
+{
+    AllOf<Preds...> pred(preds...);
+    auto units = transformView(nodes, [](HierarchyNode* n) { return static_cast<const TerritorialUnit*>(&n->unit); });
+    Vector<const TerritorialUnit*> out;
+    topN(filterView(units, [&](const TerritorialUnit* u) { return pred(*u); }), top, RankLess<Cmp>{ cmp, desc }, out);
+    return out;
+}
+
 // Determine the type of a territorial unit from its code prefix
 static std::string determineType(const std::string& c) {
     if (c == "AT")                 return "Country"; // Root code
@@ -137,7 +689,7 @@ static std::string determineType(const std::string& c) {
 
 // Build a lookup table (HashMap) mapping code string to HierarchyNode* for fast access
 static void buildLookup(HierarchyNode* node,
-    HashMap<std::string, HierarchyNode*>& lookup)
+    NodeLookup& lookup)
 {
     lookup[node->unit.code] = node;            
     for (size_t i = 0; i < node->children.size(); ++i) {
@@ -152,11 +704,16 @@ static HierarchyNode* loadRegions(const std::string& fn) {
     if (!f) throw std::runtime_error("Cannot open " + fn);
 
     // Create root node representing the country Austria
-    HierarchyNode* root = new HierarchyNode({ "Austria", "AT", "Country" });
+    TerritorialUnit austria;
+    austria.name = "Austria";
+    austria.code = "AT";
+    austria.type = "Country";
+    HierarchyNode* root = HierarchyNode::create(austria);
 
     Vector<std::pair<std::string, std::string>> entries;
     std::string line;
     while (std::getline(f, line)) {
+        STATS_COUNT(BytesRead, line.size() + 1);
         if (line.empty()) continue;            // Skip empty lines
         std::istringstream ss(line);
         std::string nm, cr;
@@ -174,19 +731,26 @@ static HierarchyNode* loadRegions(const std::string& fn) {
         u.name = e.first;
         u.code = e.second;
         u.type = determineType(e.second);
-        temp[e.second] = new HierarchyNode(u);
+        temp[e.second] = HierarchyNode::create(u);
     }
 
     // Link each node to its parent based on code: parent code is code without last digit (or "AT" if length ≤ 2)
+    STATS_SCOPE("loadRegions:link");
+    auto parentCode = [](const std::string& c) { return c.size() > 2 ? c.substr(0, c.size() - 1) : std::string("AT"); };
+    HashMap<std::string, size_t> childCount;   // Parent code → children, so each list is sized once
+    for (size_t i = 0; i < entries.size(); ++i) {
+        childCount[parentCode(entries[i].second)]++;
+    }
     for (size_t i = 0; i < entries.size(); ++i) {
         const auto& e = entries[i];
         std::string c = e.second;
-        std::string p = (c.size() > 2 ? c.substr(0, c.size() - 1) : "AT");
+        std::string p = parentCode(c);
         HierarchyNode** pptr = temp.find(p);
         if (pptr) {
             HierarchyNode* parent = *pptr;
             HierarchyNode* child = temp[c];
             child->parent = parent;              // Set child's parent
+            parent->children.reserve(*childCount.find(p));
             parent->children.push_back(child);   // Add child to parent's children vector
         }
     }
@@ -195,13 +759,18 @@ static HierarchyNode* loadRegions(const std::string& fn) {
 }
 
 static void loadMunicipalities(const std::string& fn,
-    HashMap<std::string, HierarchyNode*>& lookup)
+    NodeLookup& lookup)
 {
     std::ifstream f(fn);
     if (!f) throw std::runtime_error("Cannot open " + fn);
 
+    // Municipalities are attached once the whole file is read, so each
+    // region's child list is sized once instead of doubling as it fills
+    Vector<std::pair<HierarchyNode*, HierarchyNode*>> attach;   // (municipality, region)
+    HashMap<std::string, size_t> childCount;                    // Region code → municipalities
     std::string line;
     while (std::getline(f, line)) {
+        STATS_COUNT(BytesRead, line.size() + 1);
         if (line.empty()) continue;
         std::istringstream ss(line);
         std::string nm, cr, rr;
@@ -216,30 +785,42 @@ static void loadMunicipalities(const std::string& fn,
         u.code = code;
         u.type = "Municipality";
 
-        HierarchyNode* node = new HierarchyNode(u);
+        HierarchyNode* node = HierarchyNode::create(u);
         HierarchyNode** parentPtr = lookup.find(region);
         if (parentPtr) {
-            HierarchyNode* parent = *parentPtr;
-            node->parent = parent;
-            parent->children.push_back(node);
+            attach.push_back({ node, *parentPtr });
+            childCount[region]++;
             lookup[code] = node;                // Add municipality to lookup map
         }
         else {
-            delete node; // If region not found, drop this municipality
+            HierarchyNode::destroy(node); // If region not found, drop this municipality
+        }
+    }
+
+    for (size_t i = 0; i < attach.size(); ++i) {
+        HierarchyNode* node = attach[i].first;
+        HierarchyNode* parent = attach[i].second;
+        size_t& pending = *childCount.find(parent->unit.code);
+        if (pending) {
+            parent->children.reserve(parent->children.size() + pending);
+            pending = 0;
         }
+        node->parent = parent;
+        parent->children.push_back(node);
     }
 }
 
-// Load population data from "YYYY.csv" for each year listed in 'yrs'
-static void loadPopData(const Vector<std::string>& yrs,
-    HashMap<std::string, HierarchyNode*>& lookup)
+// Load population data from "<dir>YYYY.csv" for each year listed in 'yrs'
+static void loadPopData(const std::string& dir, const Vector<std::string>& yrs,
+    NodeLookup& lookup)
 {
     for (size_t yi = 0; yi < yrs.size(); ++yi) {
-        std::ifstream f(yrs[yi] + ".csv");
+        std::ifstream f(dir + yrs[yi] + ".csv");
         if (!f) continue;                    // Skip if file not found
         std::string line;
         std::getline(f, line);             // Skip header line
         while (std::getline(f, line)) {
+            STATS_COUNT(BytesRead, line.size() + 1);
             if (line.empty()) continue;
             std::istringstream ss(line);
             std::string nm, cr, mstr, skip, fstr;
@@ -255,7 +836,9 @@ static void loadPopData(const Vector<std::string>& yrs,
             if (nptr) {
                 HierarchyNode* node = *nptr;
                 // Add/populate entry in popByYear map for this node and year
-                auto& entry = node->unit.popByYear[yrs[yi]];
+                auto& pop = node->unit.popByYear;
+                if (pop.empty()) pop.reserve(yrs.size());   // One allocation per unit
+                auto& entry = pop[yrs[yi]];
                 entry.first += male;
                 entry.second += female;
             }
@@ -269,6 +852,7 @@ static void accumulate(HierarchyNode* n) {
         accumulate(n->children[i]);         // Recursively accumulate children first
         auto& me = n->unit.popByYear;
         auto& ch = n->children[i]->unit.popByYear;
+        if (me.empty()) me.reserve(ch.size());
         for (auto it = ch.begin(); it != ch.end(); ++it) {
             // Add child's male and female to parent's counts for each year
             me[it->first].first += it->second.first;
@@ -278,18 +862,29 @@ static void accumulate(HierarchyNode* n) {
 }
 
 // Print population summary of a TerritorialUnit across YEARS
-static void printSummary(const TerritorialUnit& u) {
-    std::cout << "\n[Summary] " << u.type << " " << u.name
-        << " (" << u.code << ")\n";
+static void printSummary(const TerritorialUnit& u, ResultWriter& out) {
+    if (out.isText()) {
+        out << "\n[Summary] " << u.type << " " << u.name
+            << " (" << u.code << ")\n";
+    }
     for (size_t i = 0; i < YEARS.size(); ++i) {
         const std::string& yr = YEARS[i];
-        int m = 0, f = 0;
-        auto it = u.popByYear.find(yr);
-        if (it != u.popByYear.end()) {
-            m = it->second.first;
-            f = it->second.second;
+        int m = unitPopulation(u, yr, Sex::Male);
+        int f = unitPopulation(u, yr, Sex::Female);
+        if (!out.isText()) {
+            // One record per year
+            out.beginRecord();
+            out.field("type", u.type);
+            out.field("name", u.name);
+            out.field("code", u.code);
+            out.field("year", yr);
+            out.field("male", m);
+            out.field("female", f);
+            out.field("total", m + f);
+            out.endRecord();
+            continue;
         }
-        std::cout << " " << yr
+        out << " " << yr
             << ": Male=" << m
             << ", Female=" << f
             << ", Total=" << (m + f)
@@ -301,11 +896,11 @@ static void printSummary(const TerritorialUnit& u) {
 // Recursively traverse the hierarchy and insert pointers into separate HashMaps by type and name
 static void buildTables(
     HierarchyNode* node,
-    HashMap<std::string, Vector<HierarchyNode*>>& countryT,
-    HashMap<std::string, Vector<HierarchyNode*>>& geoDivT,
-    HashMap<std::string, Vector<HierarchyNode*>>& stateT,
-    HashMap<std::string, Vector<HierarchyNode*>>& regionT,
-    HashMap<std::string, Vector<HierarchyNode*>>& muniT)
+    NameTable& countryT,
+    NameTable& geoDivT,
+    NameTable& stateT,
+    NameTable& regionT,
+    NameTable& muniT)
 {
     const std::string& t = node->unit.type;
     const std::string& n = node->unit.name;
@@ -324,14 +919,491 @@ static void buildTables(
 }
 
 // === Level 4: flatten + sort subtree ===
-// Recursively collect every unit under 'node' (including itself) into 'out'
-static void flattenSubtree(HierarchyNode* node, Vector<TerritorialUnit>& out) {
-    out.push_back(node->unit);                // Add current node's unit
+// Pre-order traversal: append every node to 'order' and record the slice its subtree occupies
+static void buildDfsOrder(HierarchyNode* node, NodeList& order) {
+    node->dfsBegin = order.size();
+    node->unit.id = static_cast<uint32_t>(order.size());
+    order.push_back(node);                    // Add current node
     for (size_t i = 0; i < node->children.size(); ++i) {
-        flattenSubtree(node->children[i], out); // Recurse into children
+        buildDfsOrder(node->children[i], order); // Recurse into children
+    }
+    node->dfsEnd = order.size();
+}
+
+// Every unit under 'node' (including itself) as a view into the DFS order, no copying
+static Span<HierarchyNode* const> subtreeRange(const NodeList& order, const HierarchyNode* node) {
+    return Span<HierarchyNode* const>(order.data() + node->dfsBegin, node->dfsEnd - node->dfsBegin);
+}
+
+// === Hierarchy levels ===
+// Every type is one level of the tree, from the country down to municipalities
+static const size_t LEVEL_COUNT = 5;
+static const char* const LEVEL_NAMES[LEVEL_COUNT] = { "Country", "GeoDiv", "State", "Region", "Municipality" };
+
+// Level index of a type name, or LEVEL_COUNT for an unknown type
+static size_t levelIndex(const std::string& type) {
+    for (size_t i = 0; i < LEVEL_COUNT; ++i) {
+        if (type == LEVEL_NAMES[i]) return i;
+    }
+    return LEVEL_COUNT;
+}
+
+// Split the DFS order by level; each level list stays in DFS order
+static void buildLevels(const NodeList& order, NodeList* levels) {
+    for (size_t i = 0; i < order.size(); ++i) {
+        size_t lv = levelIndex(order[i]->unit.type);
+        if (lv < LEVEL_COUNT) levels[lv].push_back(order[i]);
+    }
+}
+
+// The units of one level inside node's subtree. Because the level list is in
+// DFS order, they form one contiguous slice: those with dfsBegin in [node->dfsBegin, node->dfsEnd).
+static Span<HierarchyNode* const> levelRange(const NodeList& level, const HierarchyNode* node) {
+    auto before = [](const HierarchyNode* n, size_t pos) { return n->dfsBegin < pos; };
+    HierarchyNode* const* first = std::lower_bound(level.begin(), level.end(), node->dfsBegin, before);
+    HierarchyNode* const* last = std::lower_bound(first, level.end(), node->dfsEnd, before);
+    return Span<HierarchyNode* const>(first, static_cast<size_t>(last - first));
+}
+
+// === Population columns ===
+// Male/female counts of every unit for every loaded year, stored column-wise in
+// DFS order (row = TerritorialUnit::id), so per-year passes run over plain int arrays.
+// pack() (--compress) replaces the arrays with PackedColumns: every KEY_INTERVAL-th
+// year whole, the years in between as the change from the year before, which
+// takes far fewer bits than the counts themselves. value() and column() read
+// either form; column() decodes a packed year into a caller-owned array.
+struct PopColumns {
+    static const size_t KEY_INTERVAL = 8;   // Bounds a packed read to 8 block lookups
+
+    size_t rows = 0;
+    Vector<Vector<int>> male;     // [year index][row] (empty once packed)
+    Vector<Vector<int>> female;
+    Vector<PackedColumn> packedMale;    // [year index]: key year whole, other years the change from year - 1
+    Vector<PackedColumn> packedFemale;
+
+    // Index of a loaded year, or YEARS.size() when there is no such year
+    static size_t yearIndex(const std::string& yr) {
+        for (size_t i = 0; i < YEARS.size(); ++i) {
+            if (YEARS[i] == yr) return i;
+        }
+        return YEARS.size();
+    }
+
+    static bool isKeyYear(size_t y) { return y % KEY_INTERVAL == 0; }
+    bool isPacked() const { return !packedMale.empty(); }
+
+    // Population of one row in year y
+    int value(size_t y, size_t row, Sex s) const {
+        if (s == Sex::Total) return value(y, row, Sex::Male) + value(y, row, Sex::Female);
+        if (!isPacked()) return (s == Sex::Male ? male : female)[y][row];
+        const Vector<PackedColumn>& p = (s == Sex::Male ? packedMale : packedFemale);
+        int v = p[y].get(row);
+        for (size_t k = y; !isKeyYear(k); --k) v += p[k - 1].get(row);
+        return v;
+    }
+
+    // Male or female column of year y: the stored array, or the packed year decoded into 'scratch'
+    const int* column(size_t y, Sex s, Vector<int>& scratch) const {
+        if (!isPacked()) return (s == Sex::Male ? male : female)[y].data();
+        const Vector<PackedColumn>& p = (s == Sex::Male ? packedMale : packedFemale);
+        size_t key = y - y % KEY_INTERVAL;
+        scratch.resize(rows);
+        p[key].decode(scratch.data());
+        for (size_t k = key + 1; k <= y; ++k) p[k].addTo(scratch.data());
+        return scratch.data();
+    }
+
+    // Encode every year and release the plain arrays
+    void pack() {
+        Vector<int> change;
+        change.resize(rows);
+        for (int s = 0; s < 2; ++s) {
+            Vector<Vector<int>>& plain = (s == 0 ? male : female);
+            Vector<PackedColumn>& p = (s == 0 ? packedMale : packedFemale);
+            p.resize(plain.size());
+            for (size_t y = 0; y < plain.size(); ++y) {
+                if (isKeyYear(y)) {
+                    p[y].encode(plain[y].data(), rows);
+                    continue;
+                }
+                for (size_t i = 0; i < rows; ++i) change[i] = plain[y][i] - plain[y - 1][i];
+                p[y].encode(change.data(), rows);
+            }
+        }
+        male = Vector<Vector<int>>();
+        female = Vector<Vector<int>>();
+    }
+
+    // Add dm / df to some rows of year y. In a packed year only the blocks holding
+    // those rows are repacked, and so are the next year's when it is stored as a change.
+    void add(size_t y, const Vector<uint32_t>& rowList, int dm, int df) {
+        for (int s = 0; s < 2; ++s) {
+            int d = (s == 0 ? dm : df);
+            if (!isPacked()) {
+                Vector<int>& col = (s == 0 ? male : female)[y];
+                for (size_t i = 0; i < rowList.size(); ++i) col[rowList[i]] += d;
+                continue;
+            }
+            Vector<PackedColumn>& p = (s == 0 ? packedMale : packedFemale);
+            for (size_t i = 0; i < rowList.size(); ++i) {
+                p[y].add(rowList[i], d);
+                if (y + 1 < p.size() && !isKeyYear(y + 1)) p[y + 1].add(rowList[i], -d);
+            }
+        }
+    }
+};
+
+static int packedPopulation(const PopColumns& cols, uint32_t row, const std::string& yr, Sex sex) {
+    size_t y = PopColumns::yearIndex(yr);
+    return y == YEARS.size() ? 0 : cols.value(y, row, sex);
+}
+
+static void buildColumns(const NodeList& order, PopColumns& cols) {
+    cols.rows = order.size();
+    for (size_t y = 0; y < YEARS.size(); ++y) {
+        Vector<int> m, f;
+        m.resize(cols.rows);
+        f.resize(cols.rows);
+        for (size_t i = 0; i < cols.rows; ++i) {
+            auto it = order[i]->unit.popByYear.find(YEARS[y]);
+            if (it == order[i]->unit.popByYear.end()) continue;
+            m[i] = it->second.first;
+            f[i] = it->second.second;
+        }
+        cols.male.push_back(std::move(m));
+        cols.female.push_back(std::move(f));
+    }
+}
+
+// Change of the total population from one year to another, one value per row
+struct GrowthColumns {
+    std::string from, to;
+    Vector<int> absChange;      // total(to) - total(from)
+    Vector<double> pctChange;   // Change in percent of total(from)
+    Vector<double> cagr;        // Compound annual growth rate in percent
+};
+
+enum class GrowthMetric { Abs, Pct, Cagr };
+
+static bool parseGrowthMetric(const std::string& s, GrowthMetric& m) {
+    if (s == "abs")       m = GrowthMetric::Abs;
+    else if (s == "pct")  m = GrowthMetric::Pct;
+    else if (s == "cagr") m = GrowthMetric::Cagr;
+    else return false;
+    return true;
+}
+
+static double growthValue(const GrowthColumns& g, GrowthMetric m, size_t row) {
+    if (m == GrowthMetric::Abs) return g.absChange[row];
+    if (m == GrowthMetric::Pct) return g.pctChange[row];
+    return g.cagr[row];
+}
+
+// All growth columns for one year pair in a few straight passes over the
+// population columns. Units without population in 'from' get 0 % and 0 CAGR.
+static GrowthColumns computeGrowth(const PopColumns& pop, size_t y1, size_t y2) {
+    GrowthColumns g;
+    g.from = YEARS[y1];
+    g.to = YEARS[y2];
+    const size_t n = pop.rows;
+    g.absChange.resize(n);
+    g.pctChange.resize(n);
+    g.cagr.resize(n);
+
+    Vector<int> m1s, f1s, m2s, f2s;     // Used only for packed columns
+    const int* m1 = pop.column(y1, Sex::Male, m1s);
+    const int* f1 = pop.column(y1, Sex::Female, f1s);
+    const int* m2 = pop.column(y2, Sex::Male, m2s);
+    const int* f2 = pop.column(y2, Sex::Female, f2s);
+    int* absChange = g.absChange.data();
+    double* pct = g.pctChange.data();
+    double* cagr = g.cagr.data();
+
+    // Plain element-wise loops without branches, so the compiler can vectorize them
+    for (size_t i = 0; i < n; ++i) {
+        absChange[i] = (m2[i] + f2[i]) - (m1[i] + f1[i]);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        int base = m1[i] + f1[i];
+        pct[i] = base > 0 ? 100.0 * absChange[i] / base : 0.0;
+    }
+    int span = std::stoi(g.to) - std::stoi(g.from);
+    double exponent = span != 0 ? 1.0 / span : 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        int base = m1[i] + f1[i];
+        int cur = m2[i] + f2[i];
+        cagr[i] = (base > 0 && cur > 0 && span != 0) ? 100.0 * (std::pow(double(cur) / base, exponent) - 1.0) : 0.0;
+    }
+    return g;
+}
+
+// Growth columns computed on first use and kept per year pair
+class GrowthCache {
+public:
+    using Columns = std::shared_ptr<const GrowthColumns>;
+
+private:
+    struct Entry {
+        size_t from, to;
+        Columns cols;
+    };
+
+    const PopColumns* pop = nullptr;
+    Vector<Entry> entries;        // At most one per year pair
+    std::mutex mtx;               // Server workers share one cache
+
+public:
+    void attach(const PopColumns* p) { pop = p; }
+
+    // Forget every computed pair (the populations changed)
+    void clear() {
+        std::lock_guard<std::mutex> lock(mtx);
+        entries.clear();
+    }
+
+    // Columns for from → to (throws for a year without data)
+    Columns get(const std::string& from, const std::string& to) {
+        size_t y1 = PopColumns::yearIndex(from);
+        size_t y2 = PopColumns::yearIndex(to);
+        if (y1 == YEARS.size()) throw std::runtime_error("no data for year '" + from + "'");
+        if (y2 == YEARS.size()) throw std::runtime_error("no data for year '" + to + "'");
+
+        std::lock_guard<std::mutex> lock(mtx);
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (entries[i].from == y1 && entries[i].to == y2) return entries[i].cols;
+        }
+        Entry e;
+        e.from = y1;
+        e.to = y2;
+        e.cols = std::make_shared<const GrowthColumns>(computeGrowth(*pop, y1, y2));
+        entries.push_back(e);
+        return e.cols;
+    }
+};
+
+// Growth metric within [lo, hi]; without columns every unit passes
+struct GrowthWithin {
+    const GrowthColumns* growth;
+    GrowthMetric metric;
+    double lo, hi;
+    GrowthWithin(const GrowthColumns* g, GrowthMetric m, double l, double h) : growth(g), metric(m), lo(l), hi(h) {}
+    bool operator()(const TerritorialUnit& u) const {
+        if (!growth) return true;
+        double v = growthValue(*growth, metric, u.id);
+        return v >= lo && v <= hi;
+    }
+};
+
+// === Population index ===
+// For every year, level and sex: (population, row) pairs sorted by population,
+// so threshold and range filters are two binary searches instead of a scan.
+// The packed form (--compress) keeps, in the same slots, each level's populations
+// in DFS order as a PackedColumn: a range filter visits the blocks of the subtree's
+// level slice and skips those whose [min, max] misses the range (see indexedSelect).
+class PopulationIndex {
+private:
+    Vector<SortedIndex<int>> indexes;   // [(year * LEVEL_COUNT + level) * 3 + sex]
+    Vector<PackedColumn> columns;       // Packed form, same slots
+    Vector<uint32_t> levelPos;          // Packed form: row → position in its level list
+    bool packed = false;
+
+    static size_t slot(size_t y, size_t lv, Sex s) {
+        return (y * LEVEL_COUNT + lv) * 3 + static_cast<size_t>(s);
+    }
+
+public:
+    void build(const PopColumns& cols, const NodeList* levels, bool packedForm = false) {
+        packed = packedForm;
+        if (packed) {
+            columns.resize(YEARS.size() * LEVEL_COUNT * 3);
+            levelPos.resize(cols.rows);
+            for (size_t lv = 0; lv < LEVEL_COUNT; ++lv) {
+                for (size_t i = 0; i < levels[lv].size(); ++i) levelPos[levels[lv][i]->unit.id] = static_cast<uint32_t>(i);
+            }
+        }
+        else indexes.resize(YEARS.size() * LEVEL_COUNT * 3);
+        for (size_t y = 0; y < YEARS.size(); ++y) {
+            buildYear(cols, levels, y);
+        }
+    }
+
+    // Build the indexes of one year
+    void buildYear(const PopColumns& cols, const NodeList* levels, size_t y) {
+        Vector<int> ms, fs;
+        const int* m = cols.column(y, Sex::Male, ms);
+        const int* f = cols.column(y, Sex::Female, fs);
+        if (packed) {
+            Vector<int> male, female, total;
+            for (size_t lv = 0; lv < LEVEL_COUNT; ++lv) {
+                male.clear();
+                female.clear();
+                total.clear();
+                for (size_t i = 0; i < levels[lv].size(); ++i) {
+                    uint32_t row = levels[lv][i]->unit.id;
+                    male.push_back(m[row]);
+                    female.push_back(f[row]);
+                    total.push_back(m[row] + f[row]);
+                }
+                columns[slot(y, lv, Sex::Male)].encode(male.data(), male.size());
+                columns[slot(y, lv, Sex::Female)].encode(female.data(), female.size());
+                columns[slot(y, lv, Sex::Total)].encode(total.data(), total.size());
+            }
+            return;
+        }
+        for (size_t lv = 0; lv < LEVEL_COUNT; ++lv) {
+            SortedIndex<int>& male = indexes[slot(y, lv, Sex::Male)];
+            SortedIndex<int>& female = indexes[slot(y, lv, Sex::Female)];
+            SortedIndex<int>& total = indexes[slot(y, lv, Sex::Total)];
+            male.clear();
+            female.clear();
+            total.clear();
+            for (size_t i = 0; i < levels[lv].size(); ++i) {
+                uint32_t row = levels[lv][i]->unit.id;
+                male.add(m[row], row);
+                female.add(f[row], row);
+                total.add(m[row] + f[row], row);
+            }
+            male.finish();
+            female.finish();
+            total.finish();
+        }
+    }
+
+    // One row of level lv went from (oldMale, oldFemale) to (newMale, newFemale)
+    // in year y: only its entries in that level's three indexes move, each found
+    // by binary search (the packed form adds the change to the row's three values)
+    void update(size_t y, size_t lv, uint32_t row, int oldMale, int oldFemale, int newMale, int newFemale) {
+        if (packed) {
+            columns[slot(y, lv, Sex::Male)].add(levelPos[row], newMale - oldMale);
+            columns[slot(y, lv, Sex::Female)].add(levelPos[row], newFemale - oldFemale);
+            columns[slot(y, lv, Sex::Total)].add(levelPos[row], (newMale + newFemale) - (oldMale + oldFemale));
+            return;
+        }
+        indexes[slot(y, lv, Sex::Male)].rekey(oldMale, row, newMale);
+        indexes[slot(y, lv, Sex::Female)].rekey(oldFemale, row, newFemale);
+        indexes[slot(y, lv, Sex::Total)].rekey(oldMale + oldFemale, row, newMale + newFemale);
     }
+
+    bool isPacked() const { return packed; }
+
+    // Sorted form only
+    const SortedIndex<int>& get(size_t y, size_t lv, Sex s) const { return indexes[slot(y, lv, s)]; }
+
+    // Packed form only: populations of level lv's units, in level-list order
+    const PackedColumn& column(size_t y, size_t lv, Sex s) const { return columns[slot(y, lv, s)]; }
+
+    size_t memoryBytes() const {
+        size_t bytes = sizeof(*this);
+        for (size_t i = 0; i < indexes.size(); ++i) bytes += indexes[i].memoryBytes();
+        for (size_t i = 0; i < columns.size(); ++i) bytes += columns[i].memoryBytes();
+        return bytes + levelPos.capacity() * sizeof(uint32_t);
+    }
+};
+
+// Units of level 'lv' (LEVEL_COUNT: every level) under subRoot whose population
+// in year y is within [lo, hi], in (population, DFS position) order. The index
+// covers the whole country, so each level takes the smaller of two sources: its
+// h index hits (two binary searches; rows outside the subtree are dropped by an
+// interval check on the DFS position) or the s units of the subtree's level
+// slice, checked one by one and sorted. A level costs O(log n + min(h, s log s)).
+// A packed index answers each level from the blocks of its slice: O(s / 128)
+// block checks plus the units of the blocks that straddle the range.
+static Vector<const TerritorialUnit*> indexedSelect(const PopulationIndex& index, const PopColumns& cols,
+    const NodeList& order, const NodeList* levels, const HierarchyNode* subRoot,
+    size_t y, size_t lv, Sex sex, int lo, int hi)
+{
+    using Entry = SortedIndex<int>::Entry;
+    auto entryLess = [](const Entry& a, const Entry& b) {
+        return a.key < b.key || (a.key == b.key && a.row < b.row);
+    };
+    Vector<const TerritorialUnit*> out;
+    using Hits = Span<const Entry>;
+    Hits lists[LEVEL_COUNT];
+    Vector<Entry> scanned[LEVEL_COUNT];     // Matches of the levels answered from their slice
+    size_t listCount = 0;
+    for (size_t l = 0; l < LEVEL_COUNT; ++l) {
+        if (lv != LEVEL_COUNT && lv != l) continue;
+        Span<HierarchyNode* const> slice = levelRange(levels[l], subRoot);
+        Hits hits;
+        if (index.isPacked()) {
+            const PackedColumn& col = index.column(y, l, sex);
+            size_t first = static_cast<size_t>(slice.data() - levels[l].data());
+            Vector<uint32_t> positions;
+            col.selectBetween(lo, hi, first, first + slice.size(), positions);
+            Vector<Entry>& matches = scanned[listCount];
+            for (size_t i = 0; i < positions.size(); ++i) {
+                matches.push_back(Entry{ col.get(positions[i]), levels[l][positions[i]]->unit.id });
+            }
+            std::sort(matches.begin(), matches.end(), entryLess);
+            hits = Hits(matches.data(), matches.size());
+        }
+        else hits = index.get(y, l, sex).between(lo, hi);
+        if (!index.isPacked() && slice.size() < hits.size()) {
+            Vector<Entry>& matches = scanned[listCount];
+            for (size_t i = 0; i < slice.size(); ++i) {
+                uint32_t row = slice[i]->unit.id;
+                int v = cols.value(y, row, sex);
+                if (v >= lo && v <= hi) matches.push_back(Entry{ v, row });
+            }
+            std::sort(matches.begin(), matches.end(), entryLess);
+            hits = Hits(matches.data(), matches.size());
+        }
+        lists[listCount++] = hits;
+    }
+
+    // Merge the per-level lists (already sorted) into one
+    size_t pos[LEVEL_COUNT] = {};
+    while (true) {
+        size_t best = listCount;
+        for (size_t l = 0; l < listCount; ++l) {
+            if (pos[l] == lists[l].size()) continue;
+            const Entry& e = lists[l][pos[l]];
+            if (best == listCount) {
+                best = l;
+                continue;
+            }
+            const Entry& b = lists[best][pos[best]];
+            if (e.key < b.key || (e.key == b.key && e.row < b.row)) best = l;
+        }
+        if (best == listCount) break;
+        uint32_t row = lists[best][pos[best]++].row;
+        if (row >= subRoot->dfsBegin && row < subRoot->dfsEnd) {
+            out.push_back(&order[row]->unit);
+        }
+    }
+    return out;
+}
+
+// Keep only the units that pass every predicate (order unchanged)
+template<typename... Preds>
+static void refineUnits(Vector<const TerritorialUnit*>& units, const Preds&... preds) {
+    AllOf<Preds...> pred(preds...);
+    size_t kept = 0;
+    for (size_t i = 0; i < units.size(); ++i) {
+        if (pred(*units[i])) units[kept++] = units[i];
+    }
+    while (units.size() > kept) units.pop_back();
+}
+
+// Back to DFS order (the order a subtree scan produces)
+static void sortByDfs(Vector<const TerritorialUnit*>& units) {
+    std::sort(units.begin(), units.end(),
+        [](const TerritorialUnit* a, const TerritorialUnit* b) { return a->id < b->id; });
 }
 
+// Order by a growth metric
+struct ByGrowth {
+    const GrowthColumns* growth;
+    GrowthMetric metric;
+    ByGrowth(const GrowthColumns* g, GrowthMetric m) : growth(g), metric(m) {}
+    int operator()(const TerritorialUnit& a, const TerritorialUnit& b) const {
+        STATS_COUNT(Comparisons, 1);
+        double va = growthValue(*growth, metric, a.id);
+        double vb = growthValue(*growth, metric, b.id);
+        return (va < vb ? -1 : (va > vb ? 1 : 0));
+    }
+};
+
 // Interactive function for user to navigate hierarchy and select a subtree root
 static HierarchyNode* chooseSubtree(HierarchyNode* root) {
     HierarchyNode* cur = root;
@@ -376,49 +1448,2732 @@ static HierarchyNode* chooseSubtree(HierarchyNode* root) {
     return cur; // Return the chosen subtree root
 }
 
-int main() {
-    _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF); // Enable heap leak checking
-#ifdef _WIN32
-    // Ensure UTF-8 console on Windows (for diacritics support)
-    SetConsoleOutputCP(65001);
+// === Range sums ===
+// Fenwick trees per year and sex over each unit's own population (its value minus
+// its children's, so nothing is counted twice), in two orders:
+//   - DFS order: a subtree is the range [dfsBegin, dfsEnd)
+//   - municipality code order: a code prefix or code interval is a range
+// Sums cost O(log n); a point update touches O(log n) tree nodes.
+// The packed form (--compress) stores the same values as PackedColumns instead:
+// a sum adds up the decoded blocks of its range (O(range / 128) blocks) and an
+// update encodes the changed column again.
+class RangeSums {
+private:
+    Vector<FenwickTree<long long>> byDfs;     // [year * 2 + (0 male, 1 female)]
+    Vector<FenwickTree<long long>> byCode;    // Same, over municipalities sorted by code
+    Vector<PackedColumn> packedDfs;           // Packed form of 'byDfs'
+    Vector<PackedColumn> packedCode;          // Packed form of 'byCode'
+    bool packed = false;
+    Vector<const HierarchyNode*> municipalities;  // Sorted by code
+    Vector<uint32_t> codePos;                 // DFS row → position in 'municipalities'
+
+    static size_t slot(size_t y, Sex s) { return y * 2 + (s == Sex::Female ? 1 : 0); }
+
+    // Population of each DFS row minus that of its children
+    static void ownPopulation(const PopColumns& cols, const NodeList& order, size_t y, Sex s,
+                              Vector<long long>& own, Vector<int>& scratch) {
+        const int* pop = cols.column(y, s, scratch);
+        for (size_t i = 0; i < order.size(); ++i) {
+            long long v = pop[i];
+            const HierarchyNode* node = order[i];
+            for (size_t c = 0; c < node->children.size(); ++c) {
+                v -= pop[node->children[c]->unit.id];
+            }
+            own[i] = v;
+        }
+    }
+
+    static bool fitsInt(const Vector<long long>& values) {
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (values[i] < std::numeric_limits<int>::min() || values[i] > std::numeric_limits<int>::max()) return false;
+        }
+        return true;
+    }
+
+    // 'values' must fit in an int (see fitsInt)
+    static void encodeValues(PackedColumn& col, const Vector<long long>& values, Vector<int>& scratch) {
+        scratch.resize(values.size());
+        for (size_t i = 0; i < values.size(); ++i) scratch[i] = static_cast<int>(values[i]);
+        col.encode(scratch.data(), values.size());
+    }
+
+public:
+    void build(const PopColumns& cols, const NodeList& order, const NodeList& muniLevel, bool packedForm = false) {
+        packed = packedForm;
+        const size_t n = order.size();
+        for (size_t i = 0; i < muniLevel.size(); ++i) municipalities.push_back(muniLevel[i]);
+        std::sort(municipalities.begin(), municipalities.end(),
+            [](const HierarchyNode* a, const HierarchyNode* b) { return a->unit.code < b->unit.code; });
+        codePos.resize(n);
+        for (size_t i = 0; i < municipalities.size(); ++i) {
+            codePos[municipalities[i]->unit.id] = static_cast<uint32_t>(i);
+        }
+
+        Vector<long long> own, inCodeOrder;
+        Vector<int> scratch;
+        own.resize(n);
+        inCodeOrder.resize(municipalities.size());
+
+        // Packed columns hold ints; keep the trees if any own population does not fit
+        for (size_t y = 0; packed && y < YEARS.size(); ++y) {
+            for (int s = 0; packed && s < 2; ++s) {
+                ownPopulation(cols, order, y, s == 0 ? Sex::Male : Sex::Female, own, scratch);
+                packed = fitsInt(own);
+            }
+        }
+
+        if (packed) {
+            packedDfs.resize(YEARS.size() * 2);
+            packedCode.resize(YEARS.size() * 2);
+        }
+        else {
+            byDfs.resize(YEARS.size() * 2);
+            byCode.resize(YEARS.size() * 2);
+        }
+        for (size_t y = 0; y < YEARS.size(); ++y) {
+            for (int s = 0; s < 2; ++s) {
+                Sex sex = (s == 0 ? Sex::Male : Sex::Female);
+                ownPopulation(cols, order, y, sex, own, scratch);
+                for (size_t i = 0; i < municipalities.size(); ++i) {
+                    inCodeOrder[i] = own[municipalities[i]->unit.id];
+                }
+                if (packed) {
+                    encodeValues(packedDfs[slot(y, sex)], own, scratch);
+                    encodeValues(packedCode[slot(y, sex)], inCodeOrder, scratch);
+                    continue;
+                }
+                byDfs[slot(y, sex)].build(own.data(), n);
+                byCode[slot(y, sex)].build(inCodeOrder.data(), municipalities.size());
+            }
+        }
+    }
+
+    // Population of DFS rows [lo, hi)
+    long long dfsRange(size_t y, Sex s, size_t lo, size_t hi) const {
+        if (s == Sex::Total) return dfsRange(y, Sex::Male, lo, hi) + dfsRange(y, Sex::Female, lo, hi);
+        if (packed) return packedDfs[slot(y, s)].sum(lo, hi);
+        return byDfs[slot(y, s)].rangeSum(lo, hi);
+    }
+
+    // Population of the municipalities at code positions [lo, hi)
+    long long codeRange(size_t y, Sex s, size_t lo, size_t hi) const {
+        if (s == Sex::Total) return codeRange(y, Sex::Male, lo, hi) + codeRange(y, Sex::Female, lo, hi);
+        if (packed) return packedCode[slot(y, s)].sum(lo, hi);
+        return byCode[slot(y, s)].rangeSum(lo, hi);
+    }
+
+    // Code positions [lo, hi) of the municipalities whose code lies in [from, to]
+    void codeInterval(const std::string& from, const std::string& to, size_t& lo, size_t& hi) const {
+        auto codeBelow = [](const HierarchyNode* n, const std::string& c) { return n->unit.code < c; };
+        auto codeAbove = [](const std::string& c, const HierarchyNode* n) { return c < n->unit.code; };
+        lo = static_cast<size_t>(std::lower_bound(municipalities.begin(), municipalities.end(), from, codeBelow)
+            - municipalities.begin());
+        hi = static_cast<size_t>(std::upper_bound(municipalities.begin(), municipalities.end(), to, codeAbove)
+            - municipalities.begin());
+        if (hi < lo) hi = lo;
+    }
+
+    // Code positions [lo, hi) of the municipalities whose code starts with 'prefix':
+    // the codes from 'prefix' up to (not including) the first string after every
+    // code with that prefix, found by two binary searches
+    void codePrefix(const std::string& prefix, size_t& lo, size_t& hi) const {
+        auto codeBelow = [](const HierarchyNode* n, const std::string& c) { return n->unit.code < c; };
+        lo = static_cast<size_t>(std::lower_bound(municipalities.begin(), municipalities.end(), prefix, codeBelow)
+            - municipalities.begin());
+        // Successor of the prefix: drop trailing 0xFF bytes, then bump the last byte
+        std::string next = prefix;
+        while (!next.empty() && static_cast<unsigned char>(next.back()) == 0xFF) next.pop_back();
+        if (next.empty()) {
+            hi = municipalities.size();     // Empty prefix (or all 0xFF): everything from lo on
+            return;
+        }
+        next.back() = static_cast<char>(static_cast<unsigned char>(next.back()) + 1);
+        hi = static_cast<size_t>(std::lower_bound(municipalities.begin() + lo, municipalities.end(), next, codeBelow)
+            - municipalities.begin());
+    }
+
+    // A municipality's own population changed by (dm, df) in year y
+    void add(size_t y, const HierarchyNode* muni, int dm, int df) {
+        uint32_t row = muni->unit.id;
+        if (packed) {
+            packedDfs[slot(y, Sex::Male)].add(row, dm);
+            packedDfs[slot(y, Sex::Female)].add(row, df);
+            packedCode[slot(y, Sex::Male)].add(codePos[row], dm);
+            packedCode[slot(y, Sex::Female)].add(codePos[row], df);
+            return;
+        }
+        byDfs[slot(y, Sex::Male)].add(row, dm);
+        byDfs[slot(y, Sex::Female)].add(row, df);
+        byCode[slot(y, Sex::Male)].add(codePos[row], dm);
+        byCode[slot(y, Sex::Female)].add(codePos[row], df);
+    }
+
+    size_t memoryBytes() const {
+        size_t bytes = sizeof(*this) + codePos.capacity() * sizeof(uint32_t)
+            + municipalities.capacity() * sizeof(const HierarchyNode*);
+        for (size_t i = 0; i < byDfs.size(); ++i) bytes += byDfs[i].memoryBytes() + byCode[i].memoryBytes();
+        for (size_t i = 0; i < packedDfs.size(); ++i) bytes += packedDfs[i].memoryBytes() + packedCode[i].memoryBytes();
+        return bytes;
+    }
+};
+
+// === Result listings (shared by the menu and batch mode) ===
+
+// Level 1: print the rows of a year selected by 'rows'
+static void printFlatResults(const Vector<FlatMunicipality>& flat, const Vector<uint32_t>& rows,
+    ResultWriter& out)
+{
+    if (rows.size() == 0) {
+        if (out.isText()) out << "No matches.\n";
+        return;
+    }
+    for (size_t i = 0; i < rows.size(); ++i) {
+        printFlat(flat[rows[i]], out);      // Print each matching municipality
+    }
+}
+
+// Level 3: print every unit of type 'tp' named 'nm'
+static void printSearchResults(NameIndex* tbl, const std::string& tp, const std::string& nm,
+    ResultWriter& out)
+{
+    if (!tbl) {
+        if (out.isText()) out << "Invalid type.\n";
+        return;
+    }
+    NodeList* vecPtr = tbl->find(nm);
+    if (vecPtr == nullptr) {
+        if (out.isText()) out << "No " << tp << " named \"" << nm << "\".\n";
+        return;
+    }
+    for (size_t i = 0; i < vecPtr->size(); ++i) {
+        HierarchyNode* ptr = (*vecPtr)[i];
+        if (out.isText()) {
+            out << "\n[Search Result] "
+                << ptr->unit.type << " "
+                << ptr->unit.name << " ("
+                << ptr->unit.code << ")\n";
+        }
+        printSummary(ptr->unit, out);   // Show population summary
+    }
+}
+
+// Level 4: print sorted results; with a population sort, also the value sorted on
+// (and the growth metrics when 'growth' is given)
+static void printUnitResults(const Vector<const TerritorialUnit*>& units, bool showPop,
+    const std::string& yr, const std::string& sex, ResultWriter& out,
+    const GrowthColumns* growth = nullptr)
+{
+    if (!out.isText()) {
+        Sex s = parseSex(sex);
+        for (size_t i = 0; i < units.size(); ++i) {
+            const TerritorialUnit& u = *units[i];
+            out.beginRecord();
+            out.field("name", u.name);
+            out.field("code", u.code);
+            out.field("type", u.type);
+            if (showPop) {
+                out.field("year", yr);
+                out.field("sex", sex);
+                out.field("population", unitPopulation(u, yr, s));
+            }
+            if (growth) {
+                out.field("from", growth->from);
+                out.field("to", growth->to);
+                out.field("abs_change", growth->absChange[u.id]);
+                out.field("pct_change", growth->pctChange[u.id]);
+                out.field("cagr_pct", growth->cagr[u.id]);
+            }
+            out.endRecord();
+        }
+        return;
+    }
+    out << "\n[Results]\n";
+    for (size_t i = 0; i < units.size(); ++i) {
+        const TerritorialUnit& u = *units[i];
+        out << u.name << " (" << u.code << ")";
+        if (showPop) {
+            int val = unitPopulation(u, yr, parseSex(sex));
+            out << ": " << yr << "-" << sex << "=" << val;
+        }
+        if (growth) {
+            out << " | " << growth->from << "->" << growth->to
+                << ": abs=" << growth->absChange[u.id]
+                << ", pct=" << growth->pctChange[u.id] << "%"
+                << ", cagr=" << growth->cagr[u.id] << "%";
+        }
+        out << "\n";
+    }
+}
+
+// === Query result cache ===
+// Answers of repeated queries, keyed by the query's canonical form (defaults
+// filled in, arguments in key order, output-only arguments left out). An answer
+// is the list of DFS rows in output order, immutable and shared, so a hit is one
+// hash lookup that hands out a reference-counted pointer.
+// Every entry remembers the dataset version it was computed for; once the data
+// changes it no longer matches and is dropped at its next lookup. The cache is
+// bounded by entry count and by bytes and evicts the least recently used entry.
+class ResultCache {
+public:
+    using Rows = std::shared_ptr<const Vector<uint32_t>>;
+
+private:
+    static constexpr size_t NONE = static_cast<size_t>(-1);
+
+    struct Slot {
+        std::string key;
+        Rows rows;
+        uint64_t version = 0;
+        size_t bytes = 0;
+        size_t prev = NONE;     // LRU list: most recently used at 'head'
+        size_t next = NONE;
+    };
+
+    SizeClassPool pool;                          // Bucket storage of 'index', recycled as entries come and go
+    HashMap<std::string, size_t, PoolAllocator> index{ 1021, PoolAllocator(&pool) };  // Key → slot
+    Vector<Slot> slots;
+    Vector<size_t> freeSlots;
+    size_t head = NONE, tail = NONE;
+    std::atomic<size_t> maxEntries;   // Written under 'mtx'; enabled() reads it without the lock
+    size_t maxBytes;
+    size_t entryCount = 0;
+    size_t usedBytes = 0;
+    size_t hitCount = 0, missCount = 0, staleCount = 0, evictCount = 0;
+    mutable std::mutex mtx;   // Server workers share one cache
+
+    // Approximate memory held by one entry: slot, key, rows, hash entry, shared_ptr block
+    static size_t footprint(const std::string& key, const Vector<uint32_t>& rows) {
+        return sizeof(Slot) + key.size() + sizeof(Vector<uint32_t>) + rows.size() * sizeof(uint32_t)
+            + sizeof(std::string) + sizeof(size_t) + 2 * sizeof(void*) + 2 * sizeof(long);
+    }
+
+    void unlink(size_t s) {
+        Slot& e = slots[s];
+        if (e.prev != NONE) slots[e.prev].next = e.next;
+        else head = e.next;
+        if (e.next != NONE) slots[e.next].prev = e.prev;
+        else tail = e.prev;
+        e.prev = e.next = NONE;
+    }
+
+    void pushFront(size_t s) {
+        slots[s].next = head;
+        if (head != NONE) slots[head].prev = s;
+        head = s;
+        if (tail == NONE) tail = s;
+    }
+
+    void drop(size_t s) {
+        unlink(s);
+        index.erase(slots[s].key);
+        usedBytes -= slots[s].bytes;
+        --entryCount;
+        slots[s] = Slot();
+        freeSlots.push_back(s);
+    }
+
+    // Evict from the cold end until 'bytes' more fit
+    void makeRoom(size_t bytes) {
+        while (tail != NONE && (entryCount >= maxEntries || usedBytes + bytes > maxBytes)) {
+            drop(tail);
+            ++evictCount;
+        }
+    }
+
+public:
+    explicit ResultCache(size_t entries = 256, size_t bytes = size_t(64) << 20)
+        : maxEntries(entries), maxBytes(bytes) {}
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    // At most 'entries' answers (0 disables the cache)
+    void setCapacity(size_t entries) {
+        std::lock_guard<std::mutex> lock(mtx);
+        maxEntries = entries;
+        while (tail != NONE && entryCount > maxEntries) {
+            drop(tail);
+            ++evictCount;
+        }
+    }
+
+    bool enabled() const { return maxEntries.load(std::memory_order_relaxed) > 0; }
+
+    // Cached answer for 'key' computed at 'version', or nullptr
+    Rows get(const std::string& key, uint64_t version) {
+        std::lock_guard<std::mutex> lock(mtx);
+        size_t* s = index.find(key);
+        if (!s) {
+            ++missCount;
+            return nullptr;
+        }
+        if (slots[*s].version != version) {
+            drop(*s);               // Computed before an update
+            ++staleCount;
+            ++missCount;
+            return nullptr;
+        }
+        ++hitCount;
+        size_t slot = *s;
+        unlink(slot);
+        pushFront(slot);
+        return slots[slot].rows;
+    }
+
+    void put(const std::string& key, uint64_t version, const Rows& rows) {
+        if (!enabled()) return;
+        size_t bytes = footprint(key, *rows);
+        std::lock_guard<std::mutex> lock(mtx);
+        if (size_t* s = index.find(key)) drop(*s);   // Another thread got there first
+        if (bytes > maxBytes || maxEntries == 0) return;   // Disabled since the check above
+        makeRoom(bytes);
+
+        size_t s;
+        if (freeSlots.size() > 0) {
+            s = freeSlots[freeSlots.size() - 1];
+            freeSlots.pop_back();
+        }
+        else {
+            s = slots.size();
+            slots.push_back(Slot());
+        }
+        slots[s].key = key;
+        slots[s].rows = rows;
+        slots[s].version = version;
+        slots[s].bytes = bytes;
+        index[key] = s;
+        pushFront(s);
+        usedBytes += bytes;
+        ++entryCount;
+    }
+
+    // Hit ratio, entries and memory
+    void report(ResultWriter& out) const {
+        std::lock_guard<std::mutex> lock(mtx);
+        size_t total = hitCount + missCount;
+        double ratio = total ? 100.0 * hitCount / total : 0.0;
+        if (out.isText()) {
+            out << "\n[Result cache] entries=" << entryCount << "/" << maxEntries.load()
+                << ", memory=" << usedBytes << "/" << maxBytes << " bytes"
+                << ", hits=" << hitCount
+                << ", misses=" << missCount << " (stale " << staleCount << ")"
+                << ", evictions=" << evictCount
+                << ", hit ratio=" << ratio << "%\n";
+            return;
+        }
+        out.beginRecord();
+        out.field("entries", entryCount);
+        out.field("max_entries", maxEntries.load());
+        out.field("bytes", usedBytes);
+        out.field("max_bytes", maxBytes);
+        out.field("hits", hitCount);
+        out.field("misses", missCount);
+        out.field("stale", staleCount);
+        out.field("evictions", evictCount);
+        out.field("hit_ratio", ratio);
+        out.endRecord();
+    }
+};
+
+// === Loaded dataset ===
+// Everything built at startup; shared by the interactive menu and batch mode.
+// Must be constructed while the dataset arena (if any) is current.
+struct Dataset {
+    HierarchyNode* root = nullptr;
+    CodeIndex lookup;                    // Code → node (regions and municipalities)
+    NameIndex countryTable,              // Name → nodes, one table per type (Level 3)
+        geoDivTable,
+        stateTable,
+        regionTable,
+        municipalityTable;
+    NodeList dfsOrder;                   // Every subtree is a contiguous slice of it
+    NodeList levels[LEVEL_COUNT];        // dfsOrder split by level (see levelRange)
+    PopColumns columns;                  // Population per year in DFS order
+    GrowthCache growthCache;             // Derived growth columns per year pair
+    PopulationIndex popIndex;            // Sorted populations per year, level and sex (packed: totals per year)
+    RangeSums sums;                      // Subtree / code-range population sums
+    std::shared_mutex updateLock;        // Queries share it, "update" holds it alone
+    std::atomic<uint64_t> version{ 0 };  // Bumped by every population update
+    FlatCache flatCache{ YEARS.size() }; // Parsed year files for Level 1 queries
+    ResultCache resultCache;             // Answers of repeated filter queries
+    bool compress = false;               // Pack the population columns when loading (--compress)
+
+    Dataset() = default;
+    Dataset(const Dataset&) = delete;
+    Dataset& operator=(const Dataset&) = delete;
+    ~Dataset() {
+        if (root) HierarchyNode::destroy(root);
+    }
+
+    // Search table for a type name, or nullptr for an unknown type
+    NameIndex* tableFor(const std::string& tp) {
+        if (tp == "Country")      return &countryTable;
+        if (tp == "GeoDiv")       return &geoDivTable;
+        if (tp == "State")        return &stateTable;
+        if (tp == "Region")       return &regionTable;
+        if (tp == "Municipality") return &municipalityTable;
+        return nullptr;
+    }
+};
+
+// "data" → "data/" (empty stays empty: the working directory)
+static std::string dataDirPrefix(const std::string& dir) {
+    if (dir.empty() || dir[dir.size() - 1] == '/' || dir[dir.size() - 1] == '\\') return dir;
+    return dir + "/";
+}
+
+// Build hierarchy, load populations and build the search structures (throws on missing files).
+// The CSV files are read from 'dir'; with a 'phases' log every step is measured.
+static void loadDataset(Dataset& ds, const std::string& dir = "", PhaseLog* phases = nullptr) {
+    std::string prefix = dataDirPrefix(dir);
+    ds.flatCache.setDirectory(prefix);
+
+    // Lookup and name tables are built as HashMaps, then frozen into the dataset
+    NodeLookup lookup;
+    NameTable countryTable, geoDivTable, stateTable, regionTable, municipalityTable;
+
+    // (1) Load region hierarchy from "country.csv"
+    {
+        PhaseLog::Scope phase(phases, "loadRegions");
+        ds.root = loadRegions(prefix + "country.csv");
+    }
+
+    // (2) Build lookup table: code → HierarchyNode*
+    {
+        PhaseLog::Scope phase(phases, "buildLookup");
+        buildLookup(ds.root, lookup);
+    }
+
+    // (3) Load municipalities and attach to regions
+    {
+        PhaseLog::Scope phase(phases, "loadMunicipalities");
+        loadMunicipalities(prefix + "municipalities.csv", lookup);
+    }
+
+    // (4) Load population data for each year
+    {
+        PhaseLog::Scope phase(phases, "loadPopData");
+        loadPopData(prefix, YEARS, lookup);
+    }
+
+    // (5) Accumulate population counts upward through hierarchy
+    {
+        PhaseLog::Scope phase(phases, "accumulate");
+        accumulate(ds.root);
+    }
+
+    // (6) Build Level 3 name/type search tables
+    {
+        PhaseLog::Scope phase(phases, "buildTables");
+        buildTables(ds.root,
+            countryTable, geoDivTable,
+            stateTable, regionTable,
+            municipalityTable);
+    }
+
+    // (6b) Nothing is added to them after loading: one-probe perfect hash tables
+    {
+        PhaseLog::Scope phase(phases, "freezeTables");
+        ds.lookup.build(lookup);
+        ds.countryTable.build(countryTable);
+        ds.geoDivTable.build(geoDivTable);
+        ds.stateTable.build(stateTable);
+        ds.regionTable.build(regionTable);
+        ds.municipalityTable.build(municipalityTable);
+    }
+
+    {
+        PhaseLog::Scope phase(phases, "buildIndexes");
+
+        // (7) DFS order of all nodes, and the same order per level
+        buildDfsOrder(ds.root, ds.dfsOrder);
+        buildLevels(ds.dfsOrder, ds.levels);
+
+        // (8) Column-wise copy of the populations for vectorized passes
+        buildColumns(ds.dfsOrder, ds.columns);
+        ds.growthCache.attach(&ds.columns);
+
+        // (9) Sorted population index for range filters (--compress: packed totals)
+        ds.popIndex.build(ds.columns, ds.levels, ds.compress);
+
+        // (10) Range-sum trees over DFS and municipality code order (--compress: packed columns)
+        ds.sums.build(ds.columns, ds.dfsOrder, ds.levels[levelIndex("Municipality")], ds.compress);
+    }
+
+    // (11) --compress: the columns are packed and become the only copy of the
+    // populations; every unit's year map is released
+    if (ds.compress) {
+        PhaseLog::Scope phase(phases, "packColumns");
+        ds.columns.pack();
+        for (size_t i = 0; i < ds.dfsOrder.size(); ++i) {
+            TerritorialUnit& u = ds.dfsOrder[i]->unit;
+            u.popByYear = Map<std::string, std::pair<int, int>>();
+            u.packedPop = &ds.columns;
+        }
+    }
+}
+
+// === Compound filters ===
+// AND / OR / NOT combinations of predicates, written as one expression:
+//     type=Municipality & (pop@2024>=5000 | name~berg) & !code^108
+// Predicates:
+//     name~TEXT                        case-insensitive substring of the name
+//     type=TYPE                        one level (Country, GeoDiv, State, Region, Municipality)
+//     code^PREFIX                      code starts with PREFIX
+//     pop|male|female[@YYYY] OP N      population (default year: the query's year=)
+//     abs|pct|cagr[@FROM:TO] OP X      growth (default years: the query's growth=)
+// OP is one of < <= = >= >. Text containing spaces or operators goes in single quotes.
+//
+// Planning: every term gets an estimated selectivity (fraction of rows passing;
+// exact counts from the population index and level sizes where they exist) and a
+// cost per row (column checks are cheap, string scans are not). AND operands run
+// in order of cost / (1 - selectivity), OR operands in order of cost / selectivity,
+// so the cheap and decisive checks come first and short-circuit the rest.
+// A population bound or a type directly under the top-level AND can also choose
+// the rows to visit: a binary search in the population index or one level's slice
+// of the subtree, whichever touches the fewest rows; that operand is then skipped.
+struct FilterTerm {
+    enum Kind { And, Or, Not, Name, Type, CodePrefix, Pop, Growth };
+
+    Kind kind;
+    Vector<size_t> kids;            // And / Or / Not: operand terms
+    std::string text;               // Name / Type / CodePrefix: value as written
+    NameContains name;              // Name
+    size_t year = 0;                // Pop: year index
+    Sex sex = Sex::Total;           // Pop
+    int lo = INT_MIN, hi = INT_MAX; // Pop: inclusive bounds
+    GrowthCache::Columns growth;    // Growth: columns of the year pair
+    std::string span;               // Growth: "FROM:TO"
+    GrowthMetric metric = GrowthMetric::Pct;
+    double glo = -std::numeric_limits<double>::infinity();   // Growth: inclusive bounds
+    double ghi = std::numeric_limits<double>::infinity();
+    double selectivity = 1.0;       // Planner estimates
+    double cost = 1.0;
+
+    explicit FilterTerm(Kind k) : kind(k), name("") {}
+};
+
+class CompoundFilter {
+private:
+    static constexpr size_t NONE = static_cast<size_t>(-1);
+
+    Vector<FilterTerm> terms;
+    size_t root = NONE;
+    const PopColumns* pop;
+    size_t skipped = NONE;          // Top-level AND operand already applied by the access path
+
+    // --- Parsing ---
+    struct Parser {
+        const std::string& s;
+        size_t i;
+        void skipSpace() {
+            while (i < s.size() && std::isspace(static_cast<unsigned char>(s[i]))) ++i;
+        }
+        bool eat(char c) {
+            skipSpace();
+            if (i < s.size() && s[i] == c) {
+                ++i;
+                return true;
+            }
+            return false;
+        }
+        [[noreturn]] void fail(const std::string& what) const {
+            throw std::runtime_error("filter expression: " + what + " at position " + std::to_string(i + 1));
+        }
+        std::string word() {
+            skipSpace();
+            size_t start = i;
+            while (i < s.size() && std::isalpha(static_cast<unsigned char>(s[i]))) ++i;
+            return s.substr(start, i - start);
+        }
+        // Quoted text, or everything up to white space, a bracket or an operator
+        std::string value() {
+            skipSpace();
+            std::string v;
+            if (i < s.size() && s[i] == '\'') {
+                size_t close = s.find('\'', i + 1);
+                if (close == std::string::npos) fail("unterminated quote");
+                v = s.substr(i + 1, close - i - 1);
+                i = close + 1;
+                return v;
+            }
+            while (i < s.size() && !std::isspace(static_cast<unsigned char>(s[i])) &&
+                s[i] != '(' && s[i] != ')' && s[i] != '&' && s[i] != '|') {
+                v.push_back(s[i++]);
+            }
+            if (v.empty()) fail("missing value");
+            return v;
+        }
+        // Year or year pair after '@'
+        std::string spec() {
+            size_t start = i;
+            while (i < s.size() && (std::isdigit(static_cast<unsigned char>(s[i])) || s[i] == ':')) ++i;
+            if (i == start) fail("expected a year after '@'");
+            return s.substr(start, i - start);
+        }
+        // "<", "<=", "=", ">=" or ">"
+        std::string comparison() {
+            skipSpace();
+            std::string op;
+            if (i < s.size() && (s[i] == '<' || s[i] == '>' || s[i] == '=')) op.push_back(s[i++]);
+            if (!op.empty() && op != "=" && i < s.size() && s[i] == '=') op.push_back(s[i++]);
+            if (op.empty()) fail("expected a comparison");
+            return op;
+        }
+        double number() {
+            std::string v = value();
+            try {
+                size_t used = 0;
+                double d = std::stod(v, &used);
+                if (used == v.size()) return d;
+            }
+            catch (const std::exception&) {
+            }
+            fail("expected a number, got '" + v + "'");
+        }
+    };
+
+    size_t add(const FilterTerm& t) {
+        terms.push_back(t);
+        return terms.size() - 1;
+    }
+
+    // Operands of a chain of 'op' ('&' or '|'), combined into one term
+    size_t parseChain(Parser& p, Dataset& ds, const std::string& yr, const GrowthCache::Columns& defGrowth,
+        const std::string& defSpan, char op)
+    {
+        FilterTerm chain(op == '|' ? FilterTerm::Or : FilterTerm::And);
+        do {
+            chain.kids.push_back(op == '|' ? parseChain(p, ds, yr, defGrowth, defSpan, '&')
+                : parseFactor(p, ds, yr, defGrowth, defSpan));
+        } while (p.eat(op));
+        return chain.kids.size() == 1 ? chain.kids[0] : add(chain);
+    }
+
+    size_t parseFactor(Parser& p, Dataset& ds, const std::string& yr, const GrowthCache::Columns& defGrowth,
+        const std::string& defSpan)
+    {
+        if (p.eat('!')) {
+            FilterTerm t(FilterTerm::Not);
+            t.kids.push_back(parseFactor(p, ds, yr, defGrowth, defSpan));
+            return add(t);
+        }
+        if (p.eat('(')) {
+            size_t t = parseChain(p, ds, yr, defGrowth, defSpan, '|');
+            if (!p.eat(')')) p.fail("expected ')'");
+            return t;
+        }
+
+        std::string field = p.word();
+        if (field.empty()) p.fail("expected a predicate");
+        if (field == "name" || field == "type" || field == "code") {
+            char want = field == "name" ? '~' : (field == "type" ? '=' : '^');
+            if (!p.eat(want)) p.fail(std::string("expected '") + want + "' after " + field);
+            FilterTerm t(field == "name" ? FilterTerm::Name : (field == "type" ? FilterTerm::Type : FilterTerm::CodePrefix));
+            t.text = p.value();
+            if (t.kind == FilterTerm::Name) t.name = NameContains(t.text);
+            if (t.kind == FilterTerm::Type && levelIndex(t.text) == LEVEL_COUNT) {
+                throw std::runtime_error("unknown type '" + t.text + "'");
+            }
+            return add(t);
+        }
+
+        GrowthMetric metric;
+        if (field == "pop" || field == "male" || field == "female") {
+            FilterTerm t(FilterTerm::Pop);
+            t.sex = parseSex(field);
+            std::string y = yr;
+            if (p.eat('@')) y = p.spec();
+            t.year = PopColumns::yearIndex(y);
+            if (t.year == YEARS.size()) throw std::runtime_error("no data for year '" + y + "'");
+            t.text = field + "@" + y;
+            std::string op = p.comparison();
+            double v = p.number();
+            // Integer bounds, clamped to the int range
+            auto clamp = [](double d) {
+                return d <= INT_MIN ? INT_MIN : (d >= INT_MAX ? INT_MAX : static_cast<int>(d));
+            };
+            if (op == "<")       t.hi = clamp(std::ceil(v) - 1);
+            else if (op == "<=") t.hi = clamp(std::floor(v));
+            else if (op == ">=") t.lo = clamp(std::ceil(v));
+            else if (op == ">")  t.lo = clamp(std::floor(v) + 1);
+            else if (std::floor(v) == v) t.lo = t.hi = clamp(v);
+            else {
+                t.lo = 0;   // '=' with a fraction: nothing matches
+                t.hi = -1;
+            }
+            return add(t);
+        }
+        if (parseGrowthMetric(field, metric)) {
+            FilterTerm t(FilterTerm::Growth);
+            t.metric = metric;
+            if (p.eat('@')) {
+                t.span = p.spec();
+                size_t colon = t.span.find(':');
+                if (colon == std::string::npos) p.fail("growth expects @FROM:TO");
+                t.growth = ds.growthCache.get(t.span.substr(0, colon), t.span.substr(colon + 1));
+            }
+            else {
+                if (!defGrowth) throw std::runtime_error(field + " needs @FROM:TO or growth=FROM:TO");
+                t.span = defSpan;
+                t.growth = defGrowth;
+            }
+            t.text = field + "@" + t.span;
+            std::string op = p.comparison();
+            double v = p.number();
+            const double inf = std::numeric_limits<double>::infinity();
+            if (op == "<")       t.ghi = std::nextafter(v, -inf);
+            else if (op == "<=") t.ghi = v;
+            else if (op == ">=") t.glo = v;
+            else if (op == ">")  t.glo = std::nextafter(v, inf);
+            else t.glo = t.ghi = v;
+            return add(t);
+        }
+        p.fail("unknown predicate '" + field + "'");
+    }
+
+    // --- Evaluation ---
+    bool eval(size_t ti, const TerritorialUnit& u) const {
+        const FilterTerm& t = terms[ti];
+        switch (t.kind) {
+        case FilterTerm::And:
+            for (size_t k = 0; k < t.kids.size(); ++k) {
+                if (!(ti == root && t.kids[k] == skipped) && !eval(t.kids[k], u)) return false;
+            }
+            return true;
+        case FilterTerm::Or:
+            for (size_t k = 0; k < t.kids.size(); ++k) {
+                if (eval(t.kids[k], u)) return true;
+            }
+            return false;
+        case FilterTerm::Not:
+            return !eval(t.kids[0], u);
+        case FilterTerm::Name:
+            return t.name(u);
+        case FilterTerm::Type:
+            return u.type == t.text;
+        case FilterTerm::CodePrefix:
+            return u.code.compare(0, t.text.size(), t.text) == 0;
+        case FilterTerm::Pop: {
+            int v = pop->value(t.year, u.id, t.sex);
+            return v >= t.lo && v <= t.hi;
+        }
+        case FilterTerm::Growth: {
+            double v = growthValue(*t.growth, t.metric, u.id);
+            return v >= t.glo && v <= t.ghi;
+        }
+        }
+        return false;
+    }
+
+    // --- Planning ---
+    // Index hits of a population bound, restricted to level lv (LEVEL_COUNT: all levels)
+    static size_t indexCount(const Dataset& ds, const FilterTerm& t, size_t lv) {
+        size_t n = 0;
+        for (size_t l = 0; l < LEVEL_COUNT; ++l) {
+            if (lv != LEVEL_COUNT && lv != l) continue;
+            // The packed form estimates from its block bounds
+            if (ds.popIndex.isPacked()) n += ds.popIndex.column(t.year, l, t.sex).estimateBetween(t.lo, t.hi);
+            else n += ds.popIndex.get(t.year, l, t.sex).between(t.lo, t.hi).size();
+        }
+        return n;
+    }
+
+    // Fill in selectivity and cost bottom-up and put operands in evaluation order
+    void estimate(size_t ti, const Dataset& ds) {
+        FilterTerm& t = terms[ti];
+        double rows = ds.dfsOrder.size() > 0 ? static_cast<double>(ds.dfsOrder.size()) : 1.0;
+        switch (t.kind) {
+        case FilterTerm::Pop:
+            t.selectivity = indexCount(ds, t, LEVEL_COUNT) / rows;
+            t.cost = 1.0;
+            break;
+        case FilterTerm::Growth:
+            t.selectivity = 0.33;       // No statistics on derived columns
+            t.cost = 1.0;
+            break;
+        case FilterTerm::Type:
+            t.selectivity = ds.levels[levelIndex(t.text)].size() / rows;
+            t.cost = 2.0;
+            break;
+        case FilterTerm::CodePrefix:
+            t.selectivity = 0.1;
+            t.cost = 2.0;
+            break;
+        case FilterTerm::Name:
+            t.selectivity = 0.05;
+            t.cost = 8.0 + t.text.size();   // Byte-by-byte scan of the name
+            break;
+        case FilterTerm::Not:
+            estimate(t.kids[0], ds);
+            t.selectivity = 1.0 - terms[t.kids[0]].selectivity;
+            t.cost = terms[t.kids[0]].cost;
+            break;
+        case FilterTerm::And:
+        case FilterTerm::Or: {
+            bool isAnd = t.kind == FilterTerm::And;
+            for (size_t k = 0; k < t.kids.size(); ++k) estimate(t.kids[k], ds);
+            // Rank: expected cost per row decided
+            auto rank = [&](size_t i) {
+                const FilterTerm& c = terms[i];
+                double decided = isAnd ? 1.0 - c.selectivity : c.selectivity;
+                return c.cost / (decided > 1e-9 ? decided : 1e-9);
+            };
+            std::stable_sort(t.kids.begin(), t.kids.end(), [&](size_t a, size_t b) { return rank(a) < rank(b); });
+            double pass = 1.0, cost = 0.0;
+            for (size_t k = 0; k < t.kids.size(); ++k) {
+                const FilterTerm& c = terms[t.kids[k]];
+                cost += pass * c.cost;          // Reached only while undecided
+                pass *= isAnd ? c.selectivity : 1.0 - c.selectivity;
+            }
+            t.selectivity = isAnd ? pass : 1.0 - pass;
+            t.cost = cost;
+            break;
+        }
+        }
+    }
+
+    std::string describe(size_t ti) const {
+        const FilterTerm& t = terms[ti];
+        std::string s;
+        switch (t.kind) {
+        case FilterTerm::And:
+        case FilterTerm::Or:
+            for (size_t k = 0; k < t.kids.size(); ++k) {
+                if (ti == root && t.kids[k] == skipped) continue;
+                if (!s.empty()) s += (t.kind == FilterTerm::And ? " & " : " | ");
+                s += describe(t.kids[k]);
+            }
+            return ti == root ? s : "(" + s + ")";
+        case FilterTerm::Not:        return "!" + describe(t.kids[0]);
+        case FilterTerm::Name:       s = "name~" + t.text; break;
+        case FilterTerm::Type:       s = "type=" + t.text; break;
+        case FilterTerm::CodePrefix: s = "code^" + t.text; break;
+        case FilterTerm::Pop:
+            s = t.text + " in [" + (t.lo == INT_MIN ? "-" : std::to_string(t.lo)) + ", "
+                + (t.hi == INT_MAX ? "-" : std::to_string(t.hi)) + "]";
+            break;
+        case FilterTerm::Growth: {
+            std::ostringstream b;
+            b << t.text << " in [" << t.glo << ", " << t.ghi << "]";
+            s = b.str();
+            break;
+        }
+        }
+        std::ostringstream est;
+        est << "{sel " << t.selectivity << ", cost " << t.cost << "}";
+        return s + est.str();
+    }
+
+public:
+    // Parse 'expr'; population terms default to year 'yr', growth terms to 'defGrowth' (throws on errors)
+    CompoundFilter(Dataset& ds, const std::string& expr, const std::string& yr,
+        const GrowthCache::Columns& defGrowth, const std::string& defSpan)
+        : pop(&ds.columns)
+    {
+        Parser p{ expr, 0 };
+        p.skipSpace();
+        if (p.i < expr.size()) {
+            root = parseChain(p, ds, yr, defGrowth, defSpan, '|');
+            p.skipSpace();
+            if (p.i < expr.size()) p.fail("unexpected '" + expr.substr(p.i, 1) + "'");
+        }
+    }
+
+    // Plan and run the filter over node's subtree; the result is in DFS order.
+    // With 'plan' set, a description of the chosen plan is written to it.
+    Vector<const TerritorialUnit*> select(const Dataset& ds, const HierarchyNode* subRoot, std::string* plan) {
+        Span<HierarchyNode* const> scan = subtreeRange(ds.dfsOrder, subRoot);
+        if (root == NONE) {
+            if (plan) *plan = "subtree scan, no predicates";
+            return selectUnits(scan, TypeIs(""));
+        }
+        estimate(root, ds);
+
+        // Access path candidates among the top-level AND operands
+        Vector<size_t> top;
+        if (terms[root].kind == FilterTerm::And) top = terms[root].kids;
+        else top.push_back(root);
+        size_t lv = LEVEL_COUNT, typeTerm = NONE, popTerm = NONE;
+        for (size_t k = 0; k < top.size(); ++k) {
+            if (terms[top[k]].kind == FilterTerm::Type && typeTerm == NONE) {
+                typeTerm = top[k];
+                lv = levelIndex(terms[typeTerm].text);
+            }
+        }
+        double share = ds.dfsOrder.size() > 0
+            ? static_cast<double>(scan.size()) / ds.dfsOrder.size() : 0.0;  // Subtree's share of all rows
+        double bestRows = static_cast<double>(scan.size());
+        if (typeTerm != NONE) {
+            scan = levelRange(ds.levels[lv], subRoot);
+            bestRows = static_cast<double>(scan.size());
+        }
+        for (size_t k = 0; k < top.size(); ++k) {
+            const FilterTerm& t = terms[top[k]];
+            if (t.kind != FilterTerm::Pop) continue;
+            // Index hits are in population order and need a sort back to DFS order
+            double rows = indexCount(ds, t, lv) * share * 2.0;
+            if (rows < bestRows) {
+                bestRows = rows;
+                popTerm = top[k];
+            }
+        }
+
+        auto match = [this](const TerritorialUnit& u) { return eval(root, u); };
+        std::ostringstream how;
+        Vector<const TerritorialUnit*> out;
+        if (popTerm != NONE) {
+            const FilterTerm& t = terms[popTerm];
+            skipped = popTerm;
+            how << (ds.popIndex.isPacked() ? "population blocks " : "population index ") << t.text << " (~" << static_cast<size_t>(bestRows / 2.0) << " rows)";
+            out = indexedSelect(ds.popIndex, ds.columns, ds.dfsOrder, ds.levels, subRoot, t.year, lv, t.sex, t.lo, t.hi);
+            if (root != popTerm) refineUnits(out, match);
+            sortByDfs(out);
+        }
+        else {
+            skipped = typeTerm;
+            if (typeTerm != NONE) how << "level slice " << terms[typeTerm].text << " (" << scan.size() << " rows)";
+            else how << "subtree scan (" << scan.size() << " rows)";
+            out = selectUnits(scan, match);
+        }
+        if (plan) {
+            std::string rest = (root == skipped) ? "" : describe(root);
+            *plan = how.str() + (rest.empty() ? "" : ", then " + rest);
+        }
+        skipped = NONE;
+        return out;
+    }
+};
+
+// === Batch query mode ===
+// One query per line: a command followed by key=value arguments, e.g.
+//     filter subtree=AT12 year=2023 min=5000 sort=pop:female top=20
+//     filter subtree=AT3 where="type=Municipality & (pop>=5000 | name~berg)" explain=1
+//     flat year=2022 name=wien
+//     search type=State name=Tyrol
+//     group level=Region subtree=AT3 years=2020,2024
+//     quantile subtree=AT22 year=2024 p=50,90
+//     histogram subtree=AT3 type=Municipality edges=1000,5000,10000
+//     sum year=2024 subtree=AT111,AT112   /   sum year=2024 prefix=108
+//     update code=10801 year=2024 male=1200 female=1250
+//     summary code=AT13
+//     cache                                (result cache statistics)
+//     tables                               (shape of the code lookup and name tables)
+//     columns                              (storage of the population columns, plain or packed)
+//     children code=AT1
+// Values containing spaces are written in double quotes (name="Sankt Pölten").
+// Empty lines and lines starting with '#' are ignored.
+struct Query {
+    std::string command;
+    Map<std::string, std::string> args;
+
+    bool has(const std::string& key) const { return args.find(key) != args.end(); }
+
+    std::string get(const std::string& key, const std::string& def = "") const {
+        auto it = args.find(key);
+        return it != args.end() ? it->second : def;
+    }
+
+    int getInt(const std::string& key, int def) const {
+        auto it = args.find(key);
+        if (it == args.end()) return def;
+        try {
+            size_t used = 0;
+            int v = std::stoi(it->second, &used);
+            if (used == it->second.size()) return v;
+        }
+        catch (const std::exception&) {
+        }
+        throw std::runtime_error("'" + key + "' expects a number, got '" + it->second + "'");
+    }
+
+    double getDouble(const std::string& key, double def) const {
+        auto it = args.find(key);
+        if (it == args.end()) return def;
+        try {
+            size_t used = 0;
+            double v = std::stod(it->second, &used);
+            if (used == it->second.size()) return v;
+        }
+        catch (const std::exception&) {
+        }
+        throw std::runtime_error("'" + key + "' expects a number, got '" + it->second + "'");
+    }
+};
+
+// Split a query line into command and arguments (false for blank/comment lines)
+static bool parseQuery(const std::string& line, Query& q) {
+    q.command.clear();
+    q.args.clear();
+    size_t i = 0;
+    const size_t n = line.size();
+    auto skipSpace = [&]() {
+        while (i < n && std::isspace(static_cast<unsigned char>(line[i]))) ++i;
+    };
+
+    skipSpace();
+    if (i == n || line[i] == '#') return false;
+    while (i < n && !std::isspace(static_cast<unsigned char>(line[i]))) {
+        q.command.push_back(line[i++]);
+    }
+
+    while (true) {
+        skipSpace();
+        if (i == n) break;
+        std::string key, value;
+        while (i < n && line[i] != '=' && !std::isspace(static_cast<unsigned char>(line[i]))) {
+            key.push_back(line[i++]);
+        }
+        if (i == n || line[i] != '=') {
+            throw std::runtime_error("expected key=value, got '" + key + "'");
+        }
+        ++i; // Skip '='
+        if (i < n && line[i] == '"') {
+            ++i;
+            while (i < n && line[i] != '"') value.push_back(line[i++]);
+            if (i == n) throw std::runtime_error("unterminated quote in '" + key + "'");
+            ++i; // Skip closing quote
+        }
+        else {
+            while (i < n && !std::isspace(static_cast<unsigned char>(line[i]))) value.push_back(line[i++]);
+        }
+        q.args[key] = value;
+    }
+    return true;
+}
+
+// Node for a "code"/"subtree" argument (root when the argument is absent)
+static HierarchyNode* queryNode(Dataset& ds, const Query& q, const std::string& key) {
+    std::string code = cleanCode(q.get(key, "AT"));
+    HierarchyNode** nptr = ds.lookup.find(code);
+    if (!nptr) throw std::runtime_error("unknown code '" + code + "'");
+    return *nptr;
+}
+
+// flat year=YYYY [name=..] [min=N] [max=N] [sort=pop]  (Level 1 on one year file)
+// Rows come in file order, or in population order with sort=pop.
+static void runFlatQuery(Dataset& ds, const Query& q, ResultWriter& out) {
+    std::string yr = q.get("year");
+    if (yr.empty()) throw std::runtime_error("flat needs year=");
+    FlatCache::Rows yearData = ds.flatCache.get(yr);
+    const Vector<FlatMunicipality>& flat = yearData->rows;
+    int lo = q.getInt("min", INT_MIN);
+    int hi = q.getInt("max", INT_MAX);
+    bool popOrder = q.get("sort") == "pop";
+    NameContains name(q.get("name"));
+
+    Vector<uint32_t> rows;
+    if (lo != INT_MIN || hi != INT_MAX || popOrder) {
+        // Population range from the index, then the name check on the hits only
+        rows = flatRange(*yearData, lo, hi, popOrder);
+        size_t kept = 0;
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (name(flat[rows[i]])) rows[kept++] = rows[i];
+        }
+        while (rows.size() > kept) rows.pop_back();
+    }
+    else {
+        rows = selectRows(flat, name);
+    }
+    printFlatResults(flat, rows, out);
+}
+
+// Growth filter on one metric from its "min<metric>="/"max<metric>=" arguments
+static GrowthWithin growthFilter(const Query& q, const GrowthColumns* growth, GrowthMetric m, const std::string& name) {
+    bool used = q.has("min" + name) || q.has("max" + name);
+    return GrowthWithin(used ? growth : nullptr, m,
+        q.getDouble("min" + name, -std::numeric_limits<double>::infinity()),
+        q.getDouble("max" + name, std::numeric_limits<double>::infinity()));
+}
+
+// Result cache key of a filter query: every argument that changes the answer, in
+// key order, with the defaults spelled out and the subtree code normalized
+static std::string filterCacheKey(const Query& q, const HierarchyNode* subRoot,
+    const std::string& yr, const std::string& sortKey)
+{
+    Map<std::string, std::string> canon;
+    for (auto it = q.args.begin(); it != q.args.end(); ++it) {
+        if (it->first != "format" && !it->second.empty()) canon[it->first] = it->second;
+    }
+    canon["subtree"] = subRoot->unit.code;
+    canon["year"] = yr;
+    canon["sort"] = sortKey;
+    if (canon["order"] != "desc") canon["order"] = "asc";
+    if (canon["top"] == "0") canon["top"] = "";
+
+    std::string key = "filter";
+    for (auto it = canon.begin(); it != canon.end(); ++it) {
+        if (it->second.empty()) continue;
+        key += '\x1f';             // Cannot appear in a parsed argument
+        key += it->first;
+        key += '=';
+        key += it->second;
+    }
+    return key;
+}
+
+// filter [subtree=CODE] [type=..] [year=YYYY min=N max=N] [name=..]
+//        [growth=Y1:Y2 [minabs=|maxabs=|minpct=|maxpct=|mincagr=|maxcagr=]]
+//        [where=EXPR [explain=1]]
+//        [sort=name|pop[:male|female|total]|abs|pct|cagr] [order=asc|desc] [top=N]  (Level 4)
+// With where=, the other filter arguments are ANDed onto the expression and the
+// whole conjunction goes through the compound filter planner.
+// Answers are kept in the result cache (not with explain=1, which must plan).
+static void runFilterQuery(Dataset& ds, const Query& q, ResultWriter& out) {
+    HierarchyNode* subRoot = queryNode(ds, q, "subtree");
+    std::string yr = q.get("year", YEARS[YEARS.size() - 1]);
+    int lo = q.getInt("min", INT_MIN);
+    int hi = q.getInt("max", INT_MAX);
+
+    // Growth between two years, as derived columns shared by all queries on that pair
+    GrowthCache::Columns growth;
+    std::string span = q.get("growth");
+    if (!span.empty()) {
+        size_t colon = span.find(':');
+        if (colon == std::string::npos) throw std::runtime_error("growth expects FROM:TO, got '" + span + "'");
+        growth = ds.growthCache.get(span.substr(0, colon), span.substr(colon + 1));
+    }
+    const GrowthColumns* g = growth.get();
+    if (!g && (q.has("minabs") || q.has("maxabs") || q.has("minpct") || q.has("maxpct") ||
+        q.has("mincagr") || q.has("maxcagr"))) {
+        throw std::runtime_error("growth filters need growth=FROM:TO");
+    }
+
+    std::string sortKey = q.get("sort", "name");
+    std::string sex = "total";
+    bool byPop = sortKey.compare(0, 3, "pop") == 0;
+    GrowthMetric metric;
+    if (byPop && sortKey.size() > 4) {
+        sex = sortKey.substr(4);
+    }
+    bool desc = q.get("order", "asc") == "desc";
+    size_t top = static_cast<size_t>(q.getInt("top", 0));
+
+    // Calls 'rank' with the comparator of the sort key
+    auto withOrder = [&](auto rank) {
+        if (byPop) return rank(ByPopulation(yr, parseSex(sex)));
+        if (parseGrowthMetric(sortKey, metric)) {
+            if (!g) throw std::runtime_error("sort=" + sortKey + " needs growth=FROM:TO");
+            return rank(ByGrowth(g, metric));
+        }
+        if (sortKey != "name") throw std::runtime_error("unknown sort key '" + sortKey + "'");
+        return rank(ByName(std::locale("")));
+    };
+
+    // Repeated query: print the cached rows
+    bool cacheable = ds.resultCache.enabled() && !q.has("explain");
+    std::string cacheKey;
+    uint64_t version = ds.version.load();
+    if (cacheable) {
+        cacheKey = filterCacheKey(q, subRoot, yr, sortKey);
+        if (ResultCache::Rows rows = ds.resultCache.get(cacheKey, version)) {
+            if (rows->size() == 0) {
+                if (out.isText()) out << "No matches.\n";
+                return;
+            }
+            Vector<const TerritorialUnit*> units;
+            units.reserve(rows->size());
+            for (size_t i = 0; i < rows->size(); ++i) units.push_back(&ds.dfsOrder[(*rows)[i]]->unit);
+            printUnitResults(units, byPop, yr, sex, out, g);
+            return;
+        }
+    }
+    auto remember = [&](const Vector<const TerritorialUnit*>& units) {
+        if (!cacheable) return;
+        std::shared_ptr<Vector<uint32_t>> rows = std::make_shared<Vector<uint32_t>>();
+        rows->reserve(units.size());
+        for (size_t i = 0; i < units.size(); ++i) rows->push_back(units[i]->id);
+        ds.resultCache.put(cacheKey, version, rows);
+    };
+
+    Vector<const TerritorialUnit*> filtered;
+    bool inPopOrder = false;    // Already sorted by total population (ties in DFS order)
+    bool ranked = false;        // Already sorted and cut to top=
+    std::string type = q.get("type");
+    size_t lv = type.empty() ? LEVEL_COUNT : levelIndex(type);
+    size_t y = PopColumns::yearIndex(yr);
+    if (q.has("where")) {
+        // Plain arguments become operands of the same top-level AND
+        std::string expr = "(" + q.get("where") + ")";
+        if (!type.empty()) expr += " & type=" + type;
+        if (q.has("name")) {
+            if (q.get("name").find('\'') != std::string::npos) throw std::runtime_error("name= cannot contain ' together with where=");
+            expr += " & name~'" + q.get("name") + "'";
+        }
+        if (lo != INT_MIN) expr += " & pop>=" + std::to_string(lo);
+        if (hi != INT_MAX) expr += " & pop<=" + std::to_string(hi);
+        const char* const metrics[] = { "abs", "pct", "cagr" };
+        for (const char* m : metrics) {
+            if (q.has(std::string("min") + m)) expr += std::string(" & ") + m + ">=" + q.get(std::string("min") + m);
+            if (q.has(std::string("max") + m)) expr += std::string(" & ") + m + "<=" + q.get(std::string("max") + m);
+        }
+        CompoundFilter where(ds, expr, yr, growth, span);
+        std::string plan;
+        filtered = where.select(ds, subRoot, q.has("explain") ? &plan : nullptr);
+        if (q.has("explain") && out.isText()) out << "[Plan] " << plan << "\n";
+    }
+    else if ((lo != INT_MIN || hi != INT_MAX) && y < YEARS.size() && (type.empty() || lv < LEVEL_COUNT)) {
+        // Population range by binary search in the index, then the remaining checks on the hits
+        filtered = indexedSelect(ds.popIndex, ds.columns, ds.dfsOrder, ds.levels, subRoot, y, lv, Sex::Total, lo, hi);
+        refineUnits(filtered,
+            growthFilter(q, g, GrowthMetric::Abs, "abs"),
+            growthFilter(q, g, GrowthMetric::Pct, "pct"),
+            growthFilter(q, g, GrowthMetric::Cagr, "cagr"),
+            NameContains(q.get("name")));
+        inPopOrder = true;
+    }
+    else if (top > 0) {
+        // Scan, rank and cut in one pass; cheap integer checks before the string scan
+        filtered = withOrder([&](const auto& cmp) {
+            return selectTopUnits(subtreeRange(ds.dfsOrder, subRoot), cmp, desc, top,
+                TypeIs(type),
+                PopulationBetween(yr, lo, hi),
+                growthFilter(q, g, GrowthMetric::Abs, "abs"),
+                growthFilter(q, g, GrowthMetric::Pct, "pct"),
+                growthFilter(q, g, GrowthMetric::Cagr, "cagr"),
+                NameContains(q.get("name")));
+        });
+        ranked = true;
+    }
+    else {
+        // Cheap integer checks before the string scan
+        filtered = selectUnits(subtreeRange(ds.dfsOrder, subRoot),
+            TypeIs(type),
+            PopulationBetween(yr, lo, hi),
+            growthFilter(q, g, GrowthMetric::Abs, "abs"),
+            growthFilter(q, g, GrowthMetric::Pct, "pct"),
+            growthFilter(q, g, GrowthMetric::Cagr, "cagr"),
+            NameContains(q.get("name")));
+    }
+    if (filtered.size() == 0) {
+        remember(filtered);
+        if (out.isText()) out << "No matches.\n";
+        return;
+    }
+
+    // Index hits are already in total-population order. For any other order, go
+    // back to DFS order first so ties come out exactly as after a scan.
+    if (inPopOrder && !(byPop && parseSex(sex) == Sex::Total)) {
+        sortByDfs(filtered);
+        inPopOrder = false;
+    }
+    if (inPopOrder) {
+        if (desc) std::reverse(filtered.begin(), filtered.end());
+        if (top > 0 && filtered.size() > top) filtered.resize(top);
+    }
+    else if (!ranked) {
+        withOrder([&](const auto& cmp) { rankUnits(filtered, cmp, desc, top); });
+    }
+    remember(filtered);
+    printUnitResults(filtered, byPop, yr, sex, out, g);
+}
+
+// group level=State|Region|...|all [subtree=CODE] [years=Y1,Y2,..]
+// Male/female/total per year for every unit of a level under a node, read from the
+// totals accumulate() already stored. One level is one contiguous slice of its
+// level list; level=all is one pass over the subtree's DFS slice, every level at once.
+static void runGroupQuery(Dataset& ds, const Query& q, ResultWriter& out) {
+    HierarchyNode* subRoot = queryNode(ds, q, "subtree");
+    std::string level = q.get("level");
+    Span<HierarchyNode* const> groups;
+    if (level == "all") {
+        groups = subtreeRange(ds.dfsOrder, subRoot);
+    }
+    else {
+        size_t lv = levelIndex(level);
+        if (lv == LEVEL_COUNT) {
+            throw std::runtime_error("group needs level=Country|GeoDiv|State|Region|Municipality|all");
+        }
+        groups = levelRange(ds.levels[lv], subRoot);
+    }
+
+    // Requested years, in the order given (all loaded years by default)
+    Vector<std::string> years;
+    std::string list = q.get("years");
+    if (list.empty()) {
+        years = YEARS;
+    }
+    else {
+        std::istringstream ss(list);
+        std::string yr;
+        while (std::getline(ss, yr, ',')) {
+            bool known = false;
+            for (size_t i = 0; i < YEARS.size(); ++i) known = known || YEARS[i] == yr;
+            if (!known) throw std::runtime_error("no data for year '" + yr + "'");
+            years.push_back(yr);
+        }
+    }
+
+    if (groups.empty()) {
+        if (out.isText()) out << "No " << level << " units under " << subRoot->unit.name << ".\n";
+        return;
+    }
+    if (out.isText()) {
+        out << "\n[Group by " << level << " under " << subRoot->unit.name
+            << " (" << subRoot->unit.code << ")] " << groups.size() << " groups\n";
+    }
+    for (HierarchyNode* n : groups) {
+        const TerritorialUnit& u = n->unit;
+        if (out.isText()) out << u.type << " " << u.name << " (" << u.code << ")\n";
+        for (size_t i = 0; i < years.size(); ++i) {
+            int m = unitPopulation(u, years[i], Sex::Male);
+            int f = unitPopulation(u, years[i], Sex::Female);
+            if (out.isText()) {
+                out << "  " << years[i] << ": Male=" << m << ", Female=" << f << ", Total=" << (m + f) << "\n";
+                continue;
+            }
+            out.beginRecord();
+            out.field("level", u.type);
+            out.field("name", u.name);
+            out.field("code", u.code);
+            out.field("year", years[i]);
+            out.field("male", m);
+            out.field("female", f);
+            out.field("total", m + f);
+            out.endRecord();
+        }
+    }
+}
+
+// === Distribution queries ===
+// The population of every unit of one level (default: municipalities) under a
+// subtree, for one year and sex, gathered from the population columns. The units
+// are one slice of the level list, so gathering is O(k) for k units.
+struct PopulationSample {
+    HierarchyNode* subRoot;
+    std::string level, year, sex;
+    Vector<int> values;
+};
+
+static void gatherSample(Dataset& ds, const Query& q, PopulationSample& s) {
+    s.subRoot = queryNode(ds, q, "subtree");
+    s.level = q.get("type", "Municipality");
+    s.year = q.get("year", YEARS[YEARS.size() - 1]);
+    s.sex = q.get("sex", "total");
+    size_t lv = levelIndex(s.level);
+    if (lv == LEVEL_COUNT) throw std::runtime_error("unknown type '" + s.level + "'");
+    size_t y = PopColumns::yearIndex(s.year);
+    if (y == YEARS.size()) throw std::runtime_error("no data for year '" + s.year + "'");
+    if (s.sex != "male" && s.sex != "female" && s.sex != "total") {
+        throw std::runtime_error("sex expects male, female or total");
+    }
+
+    Span<HierarchyNode* const> units = levelRange(ds.levels[lv], s.subRoot);
+    Vector<int> ms, fs;
+    const int* m = ds.columns.column(y, Sex::Male, ms);
+    const int* f = ds.columns.column(y, Sex::Female, fs);
+    Sex sex = parseSex(s.sex);
+    s.values.reserve(units.size());
+    for (HierarchyNode* n : units) {
+        uint32_t row = n->unit.id;
+        s.values.push_back(sex == Sex::Male ? m[row] : (sex == Sex::Female ? f[row] : m[row] + f[row]));
+    }
+}
+
+// Comma-separated list of numbers ("50,90,99")
+static Vector<double> parseNumberList(const std::string& key, const std::string& list) {
+    Vector<double> out;
+    std::istringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        try {
+            size_t used = 0;
+            double v = std::stod(item, &used);
+            if (used == item.size()) {
+                out.push_back(v);
+                continue;
+            }
+        }
+        catch (const std::exception&) {
+        }
+        throw std::runtime_error("'" + key + "' expects numbers, got '" + item + "'");
+    }
+    return out;
+}
+
+static void printSampleHeader(const char* what, const PopulationSample& s, ResultWriter& out) {
+    out << "\n[" << what << "] " << s.level << " in " << s.subRoot->unit.name
+        << " (" << s.subRoot->unit.code << "), " << s.year << " " << s.sex
+        << ", n=" << s.values.size() << "\n";
+}
+
+// Put the values of ranks ks[a, b) (ascending, distinct, all within [lo, hi)) at
+// their sorted positions: select the middle rank, then each half of the ranks
+// within its own side of it. O(n log m) expected for m ranks.
+static void multiSelect(int* v, size_t lo, size_t hi, const size_t* ks, size_t a, size_t b) {
+    if (a >= b) return;
+    size_t mid = a + (b - a) / 2;
+    std::nth_element(v + lo, v + ks[mid], v + hi);
+    multiSelect(v, lo, ks[mid], ks, a, mid);
+    multiSelect(v, ks[mid] + 1, hi, ks, mid + 1, b);
+}
+
+// quantile [subtree=CODE] [type=Municipality] [year=YYYY] [sex=..] [p=50,90,...]
+// Nearest-rank percentiles (p=50 is the median). All requested ranks are
+// selected together (see multiSelect): O(n log m) expected for m percentiles.
+static void runQuantileQuery(Dataset& ds, const Query& q, ResultWriter& out) {
+    PopulationSample s;
+    gatherSample(ds, q, s);
+    Vector<double> ps = parseNumberList("p", q.get("p", "50"));
+    for (size_t i = 0; i < ps.size(); ++i) {
+        if (ps[i] < 0 || ps[i] > 100) throw std::runtime_error("percentiles must be within 0..100");
+    }
+    std::sort(ps.begin(), ps.end());
+
+    if (out.isText()) printSampleHeader("Quantiles", s, out);
+    if (s.values.empty()) {
+        if (out.isText()) out << "No units.\n";
+        return;
+    }
+    const size_t n = s.values.size();
+    int* v = s.values.data();
+    Vector<size_t> ks;        // Position of each percentile's value once sorted
+    Vector<size_t> distinct;
+    for (size_t i = 0; i < ps.size(); ++i) {
+        size_t rank = static_cast<size_t>(std::ceil(ps[i] / 100.0 * n));
+        ks.push_back(rank > 0 ? rank - 1 : 0);
+        if (distinct.empty() || distinct[distinct.size() - 1] != ks[i]) distinct.push_back(ks[i]);
+    }
+    multiSelect(v, 0, n, distinct.data(), 0, distinct.size());
+
+    for (size_t i = 0; i < ps.size(); ++i) {
+        size_t k = ks[i];
+        if (out.isText()) {
+            out << "  p" << ps[i] << " = " << v[k] << "\n";
+            continue;
+        }
+        out.beginRecord();
+        out.field("p", ps[i]);
+        out.field("value", v[k]);
+        out.field("n", n);
+        out.endRecord();
+    }
+}
+
+// histogram [subtree=CODE] [type=Municipality] [year=YYYY] [sex=..] [edges=E1,E2,...]
+// Count of units per size class [E(i), E(i+1)); one pass, binary search per unit
+static void runHistogramQuery(Dataset& ds, const Query& q, ResultWriter& out) {
+    PopulationSample s;
+    gatherSample(ds, q, s);
+    Vector<double> edges = parseNumberList("edges", q.get("edges", "500,1000,2500,5000,10000,50000,100000"));
+    std::sort(edges.begin(), edges.end());
+
+    Vector<size_t> counts;
+    counts.resize(edges.size() + 1);  // counts[i] = below edges[i]; the last one is open
+    for (size_t i = 0; i < s.values.size(); ++i) {
+        size_t bin = static_cast<size_t>(
+            std::upper_bound(edges.begin(), edges.end(), static_cast<double>(s.values[i])) - edges.begin());
+        counts[bin]++;
+    }
+
+    if (out.isText()) printSampleHeader("Histogram", s, out);
+    for (size_t i = 0; i < counts.size(); ++i) {
+        std::ostringstream label;
+        label << "[" << (i == 0 ? std::string("0") : std::to_string(static_cast<long long>(edges[i - 1])))
+            << ", " << (i == edges.size() ? std::string("inf") : std::to_string(static_cast<long long>(edges[i])))
+            << ")";
+        if (out.isText()) {
+            out << "  " << label.str() << ": " << counts[i] << "\n";
+            continue;
+        }
+        out.beginRecord();
+        out.field("bin", label.str());
+        out.field("count", counts[i]);
+        out.endRecord();
+    }
+}
+
+// sum year=YYYY [sex=..] (subtree=CODE[,CODE..] | prefix=CODE | from=CODE to=CODE)
+// Population of a union of subtrees, or of the municipalities in a code range,
+// from the range-sum trees: O(log n) per subtree or code range (--compress:
+// the packed blocks of the range).
+static void runSumQuery(Dataset& ds, const Query& q, ResultWriter& out) {
+    std::string yr = q.get("year", YEARS[YEARS.size() - 1]);
+    size_t y = PopColumns::yearIndex(yr);
+    if (y == YEARS.size()) throw std::runtime_error("no data for year '" + yr + "'");
+
+    long long male = 0, female = 0;
+    size_t units = 0;
+    std::string over;
+    if (q.has("prefix") || q.has("from") || q.has("to")) {
+        size_t lo, hi;
+        if (q.has("prefix")) {
+            ds.sums.codePrefix(q.get("prefix"), lo, hi);
+            over = "codes " + q.get("prefix") + "*";
+        }
+        else {
+            ds.sums.codeInterval(q.get("from"), q.get("to", q.get("from")), lo, hi);
+            over = "codes " + q.get("from") + ".." + q.get("to", q.get("from"));
+        }
+        male = ds.sums.codeRange(y, Sex::Male, lo, hi);
+        female = ds.sums.codeRange(y, Sex::Female, lo, hi);
+        units = hi - lo;
+    }
+    else {
+        // Union of subtrees: nested or repeated ones are merged first so nothing counts twice
+        Vector<std::pair<size_t, size_t>> ranges;
+        std::istringstream ss(q.get("subtree", "AT"));
+        std::string code;
+        while (std::getline(ss, code, ',')) {
+            HierarchyNode** nptr = ds.lookup.find(cleanCode(code));
+            if (!nptr) throw std::runtime_error("unknown code '" + code + "'");
+            ranges.push_back(std::make_pair((*nptr)->dfsBegin, (*nptr)->dfsEnd));
+        }
+        std::sort(ranges.begin(), ranges.end());
+        size_t reach = 0;
+        for (size_t i = 0; i < ranges.size(); ++i) {
+            size_t lo = ranges[i].first > reach ? ranges[i].first : reach;
+            size_t hi = ranges[i].second;
+            if (hi <= lo) continue;
+            male += ds.sums.dfsRange(y, Sex::Male, lo, hi);
+            female += ds.sums.dfsRange(y, Sex::Female, lo, hi);
+            units += hi - lo;
+            reach = hi;
+        }
+        over = "subtrees " + q.get("subtree", "AT");
+    }
+
+    if (out.isText()) {
+        out << "\n[Sum] " << yr << " over " << over << " (" << units << " units): Male=" << male
+            << ", Female=" << female << ", Total=" << (male + female) << "\n";
+        return;
+    }
+    out.beginRecord();
+    out.field("year", yr);
+    out.field("units", units);
+    out.field("male", male);
+    out.field("female", female);
+    out.field("total", male + female);
+    out.endRecord();
+}
+
+// update code=MUNICIPALITY year=YYYY [male=N] [female=N]
+// Point update of one municipality. The new counts are added to every ancestor
+// (no accumulate() pass), the range sums take the delta, the changed rows move
+// within the year's population index, growth columns are dropped and the dataset
+// version goes up.
+static void runUpdateQuery(Dataset& ds, const Query& q, ResultWriter& out) {
+    HierarchyNode* node = queryNode(ds, q, "code");
+    if (node->unit.type != "Municipality") throw std::runtime_error("update only applies to municipalities");
+    std::string yr = q.get("year");
+    size_t y = PopColumns::yearIndex(yr);
+    if (y == YEARS.size()) throw std::runtime_error("no data for year '" + yr + "'");
+
+    int oldMale = unitPopulation(node->unit, yr, Sex::Male);
+    int oldFemale = unitPopulation(node->unit, yr, Sex::Female);
+    int newMale = q.getInt("male", oldMale);
+    int newFemale = q.getInt("female", oldFemale);
+    if (newMale < 0 || newFemale < 0) throw std::runtime_error("population cannot be negative");
+    int dm = newMale - oldMale;
+    int df = newFemale - oldFemale;
+
+    Vector<uint32_t> rows;      // The municipality and every ancestor
+    Vector<std::pair<int, int>> before;     // Their (male, female) before the update
+    for (HierarchyNode* n = node; n; n = n->parent) {
+        rows.push_back(n->unit.id);
+        before.push_back(std::make_pair(ds.columns.value(y, n->unit.id, Sex::Male),
+            ds.columns.value(y, n->unit.id, Sex::Female)));
+        if (n->unit.packedPop) continue;    // --compress: no year map to keep in step
+        auto& entry = n->unit.popByYear[yr];
+        entry.first += dm;
+        entry.second += df;
+    }
+    ds.columns.add(y, rows, dm, df);
+    ds.sums.add(y, node, dm, df);
+    size_t i = 0;
+    for (HierarchyNode* n = node; n; n = n->parent, ++i) {
+        size_t lv = levelIndex(n->unit.type);
+        if (lv == LEVEL_COUNT) continue;
+        ds.popIndex.update(y, lv, rows[i], before[i].first, before[i].second,
+            before[i].first + dm, before[i].second + df);
+    }
+    ds.growthCache.clear();
+    uint64_t version = ++ds.version;
+
+    if (out.isText()) {
+        out << "Updated " << node->unit.name << " (" << node->unit.code << ") " << yr
+            << ": Male=" << newMale << ", Female=" << newFemale << " (dataset version " << version << ")\n";
+        return;
+    }
+    out.beginRecord();
+    out.field("code", node->unit.code);
+    out.field("year", yr);
+    out.field("male", newMale);
+    out.field("female", newFemale);
+    out.field("version", static_cast<size_t>(version));
+    out.endRecord();
+}
+
+// Output format asked for by a query's "format=" argument ('def' when absent)
+static OutputFormat queryFormat(const Query& q, OutputFormat def) {
+    if (!q.has("format")) return def;
+    OutputFormat fmt;
+    if (!parseOutputFormat(q.get("format"), fmt)) {
+        throw std::runtime_error("unknown format '" + q.get("format") + "' (text, csv or jsonl)");
+    }
+    return fmt;
+}
+
+// One table's HashMapStats; with 'tagged' the record starts with "kind":"table" (--stats report)
+static void printTableStats(const std::string& name, const HashMapStats& s, ResultWriter& out, bool tagged = false) {
+    std::string hist;   // "length:buckets" for every chain length that occurs
+    for (size_t k = 0; k < s.chainHistogram.size(); ++k) {
+        if (!s.chainHistogram[k]) continue;
+        if (!hist.empty()) hist += ' ';
+        hist += std::to_string(k) + ":" + std::to_string(s.chainHistogram[k]);
+    }
+    if (out.isText()) {
+        out << name << ": size=" << s.size
+            << ", buckets=" << s.bucketCount << " (" << s.usedBuckets << " used)"
+            << ", load factor=" << s.loadFactor
+            << ", chain mean=" << s.meanChain << " max=" << s.maxChain
+            << ", probes per hit=" << s.meanProbesHit
+            << ", memory=" << s.memoryBytes << " bytes\n"
+            << "  chains (length:buckets) " << hist << "\n";
+        if (s.lookups) {
+            out << "  measured: lookups=" << static_cast<size_t>(s.lookups)
+                << ", probes per lookup=" << static_cast<double>(s.probes) / s.lookups
+                << ", max probes=" << static_cast<size_t>(s.maxProbes) << "\n";
+        }
+        return;
+    }
+    out.beginRecord();
+    if (tagged) out.field("kind", "table");
+    out.field("table", name);
+    out.field("size", s.size);
+    out.field("buckets", s.bucketCount);
+    out.field("used_buckets", s.usedBuckets);
+    out.field("load_factor", s.loadFactor);
+    out.field("mean_chain", s.meanChain);
+    out.field("max_chain", s.maxChain);
+    out.field("probes_per_hit", s.meanProbesHit);
+    out.field("memory_bytes", s.memoryBytes);
+    out.field("chains", hist);
+    out.field("lookups", static_cast<size_t>(s.lookups));
+    out.field("probes", static_cast<size_t>(s.probes));
+    out.field("max_probes", static_cast<size_t>(s.maxProbes));
+    out.endRecord();
+}
+
+// tables  (the code lookup, then the name table of every level)
+static void runTablesQuery(Dataset& ds, ResultWriter& out, bool tagged = false) {
+    printTableStats("lookup", ds.lookup.inspect(), out, tagged);
+    for (size_t l = 0; l < LEVEL_COUNT; ++l) {
+        printTableStats(LEVEL_NAMES[l], ds.tableFor(LEVEL_NAMES[l])->inspect(), out, tagged);
+    }
+}
+
+// columns  (one line per year and sex: encoding, bits per value, memory; then the index sizes)
+static void runColumnsQuery(Dataset& ds, ResultWriter& out, bool tagged = false) {
+    const PopColumns& cols = ds.columns;
+    const size_t plainBytes = cols.rows * sizeof(int);
+    size_t total = 0;
+    for (size_t y = 0; y < YEARS.size(); ++y) {
+        for (int s = 0; s < 2; ++s) {
+            const char* sex = (s == 0 ? "male" : "female");
+            const char* encoding = "plain";
+            double bits = 32.0;
+            size_t bytes = plainBytes;
+            if (cols.isPacked()) {
+                const PackedColumn& p = (s == 0 ? cols.packedMale : cols.packedFemale)[y];
+                encoding = PopColumns::isKeyYear(y) ? "whole" : "change";
+                bits = p.meanBits();
+                bytes = p.memoryBytes();
+            }
+            total += bytes;
+            if (out.isText()) {
+                out << YEARS[y] << " " << sex << ": " << encoding << ", "
+                    << bits << " bits per value, memory=" << bytes << " bytes\n";
+                continue;
+            }
+            out.beginRecord();
+            if (tagged) out.field("kind", "column");
+            out.field("year", YEARS[y]);
+            out.field("sex", sex);
+            out.field("encoding", encoding);
+            out.field("rows", cols.rows);
+            out.field("bits_per_value", bits);
+            out.field("memory_bytes", bytes);
+            out.endRecord();
+        }
+    }
+    if (out.isText()) {
+        out << "total: " << total << " bytes (" << YEARS.size() * 2 * plainBytes << " as plain arrays)\n"
+            << "population index: " << ds.popIndex.memoryBytes() << " bytes, range sums: "
+            << ds.sums.memoryBytes() << " bytes" << (cols.isPacked() ? " (packed)" : "") << "\n";
+    }
+}
+
+// Run one parsed query, writing its result listing to 'out' (throws on bad queries)
+static void runQuery(Dataset& ds, const Query& q, ResultWriter& out) {
+    STATS_SCOPE("query:" + q.command);
+    if (q.command == "update") {
+        std::unique_lock<std::shared_mutex> lock(ds.updateLock);
+        runUpdateQuery(ds, q, out);
+        return;
+    }
+    std::shared_lock<std::shared_mutex> lock(ds.updateLock);
+    if (q.command == "filter") {
+        runFilterQuery(ds, q, out);
+    }
+    else if (q.command == "flat") {
+        runFlatQuery(ds, q, out);
+    }
+    else if (q.command == "group") {
+        runGroupQuery(ds, q, out);
+    }
+    else if (q.command == "cache") {
+        ds.resultCache.report(out);
+    }
+    else if (q.command == "tables") {
+        runTablesQuery(ds, out);
+    }
+    else if (q.command == "columns") {
+        runColumnsQuery(ds, out);
+    }
+    else if (q.command == "sum") {
+        runSumQuery(ds, q, out);
+    }
+    else if (q.command == "quantile") {
+        runQuantileQuery(ds, q, out);
+    }
+    else if (q.command == "histogram") {
+        runHistogramQuery(ds, q, out);
+    }
+    else if (q.command == "search") {
+        std::string tp = q.get("type");
+        printSearchResults(ds.tableFor(tp), tp, q.get("name"), out);
+    }
+    else if (q.command == "summary") {
+        printSummary(queryNode(ds, q, "code")->unit, out);
+    }
+    else if (q.command == "children") {
+        HierarchyNode* cur = queryNode(ds, q, "code");
+        for (size_t i = 0; i < cur->children.size(); ++i) {
+            const TerritorialUnit& c = cur->children[i]->unit;
+            if (out.isText()) {
+                out << "  [" << i << "] " << c.name << " (" << c.code << ")\n";
+                continue;
+            }
+            out.beginRecord();
+            out.field("index", i);
+            out.field("name", c.name);
+            out.field("code", c.code);
+            out.field("type", c.type);
+            out.endRecord();
+        }
+    }
+    else {
+        throw std::runtime_error("unknown command '" + q.command + "'");
+    }
+}
+
+// Run every query read from 'in'. Results go to stdout through one large buffer
+// in format 'fmt' (a query's "format=" overrides it for that query).
+// The overall throughput is reported on stderr, with 'verbose' also every query's latency.
+static void runBatch(Dataset& ds, std::istream& in, OutputFormat fmt, bool verbose) {
+    const size_t FLUSH_AT = 1 << 20;      // Write results in chunks of about 1 MB
+    ResultWriter result(std::cout, fmt, FLUSH_AT);
+    Vector<double> latencies;             // Milliseconds per query
+    size_t errors = 0;
+
+    auto batchStart = std::chrono::steady_clock::now();
+    std::string line;
+    size_t lineNo = 0;
+    while (std::getline(in, line)) {
+        ++lineNo;
+        if (!line.empty() && line[line.size() - 1] == '\r') line.pop_back();
+        Query q;
+        auto t0 = std::chrono::steady_clock::now();
+        try {
+            if (!parseQuery(line, q)) continue;
+            result.setFormat(queryFormat(q, fmt));
+            if (result.isText()) {
+                result << "### " << line << "\n";
+            }
+            else {
+                result.beginRecord();
+                result.field("query", line);
+                result.endRecord();
+                result.newResultSet();
+            }
+            runQuery(ds, q, result);
+        }
+        catch (const std::exception& e) {
+            if (result.isText()) {
+                result << "Error (line " << lineNo << "): " << e.what() << "\n";
+            }
+            else {
+                result.beginRecord();
+                result.field("error", std::string(e.what()));
+                result.field("line", static_cast<size_t>(lineNo));
+                result.endRecord();
+                result.newResultSet();
+            }
+            ++errors;
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        latencies.push_back(ms);
+        if (verbose) std::cerr << "[batch] #" << latencies.size() << " " << ms << " ms  " << line << "\n";
+    }
+    result.flush();
+    std::cout.flush();
+
+    double totalMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - batchStart).count();
+    size_t n = latencies.size();
+    std::cerr << "[batch] " << n << " queries (" << errors << " errors) in " << totalMs << " ms";
+    if (n > 0 && totalMs > 0) {
+        std::sort(latencies.begin(), latencies.end());
+        std::cerr << ", " << (n * 1000.0 / totalMs) << " queries/s"
+            << ", p50=" << latencies[n / 2] << " ms"
+            << ", p99=" << latencies[(n * 99) / 100 < n ? (n * 99) / 100 : n - 1] << " ms";
+    }
+    std::cerr << "\n";
+}
+
+// === Query server (Unix domain socket, Linux only) ===
+// Protocol: every message is a frame = 4-byte little-endian payload length + payload.
+//   request payload:  one query line in batch syntax ("filter subtree=AT12 year=2023 ...")
+//   response payload: 1 status byte ('0' ok, '1' error) followed by the result text
+// Requests on one connection are answered in order; several connections are served in parallel.
+// A client that shuts down its sending side still gets the answers to what it sent.
+#ifdef __linux__
+
+static const uint32_t MAX_FRAME = 1u << 20;           // Largest request accepted (1 MB)
+static const uint32_t MAX_REPLY_FRAME = 64u << 20;    // Largest response sent or accepted (64 MB)
+static const size_t MAX_BUFFERED = 4 + MAX_FRAME;     // Unconsumed input per connection before reading pauses
+
+static void appendFrame(std::string& buf, const std::string& payload) {
+    uint32_t n = static_cast<uint32_t>(payload.size());
+    unsigned char hdr[4] = {
+        static_cast<unsigned char>(n), static_cast<unsigned char>(n >> 8),
+        static_cast<unsigned char>(n >> 16), static_cast<unsigned char>(n >> 24) };
+    buf.append(reinterpret_cast<const char*>(hdr), 4);
+    buf += payload;
+}
+
+static uint32_t frameLength(const char* p) {
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+    return u[0] | (u[1] << 8) | (u[2] << 16) | (static_cast<uint32_t>(u[3]) << 24);
+}
+
+// Answer one request payload (never throws)
+static std::string answerRequest(Dataset& ds, const std::string& line, OutputFormat fmt) {
+    ResultWriter out(fmt);
+    out << '0';
+    try {
+        Query q;
+        if (parseQuery(line, q)) {
+            out.setFormat(queryFormat(q, fmt));
+            runQuery(ds, q, out);
+        }
+    }
+    catch (const std::exception& e) {
+        out.clear();
+        out << '1' << "Error: " << e.what() << "\n";
+    }
+    if (out.buffer().size() > MAX_REPLY_FRAME) {
+        out.clear();
+        out << '1' << "Error: result larger than " << (MAX_REPLY_FRAME >> 20) << " MB, narrow the query\n";
+    }
+    return out.buffer();
+}
+
+static volatile std::sig_atomic_t g_stopServer = 0;
+static int g_wakeFd = -1;
+
+static void onStopSignal(int) {
+    g_stopServer = 1;
+    uint64_t one = 1;
+    ssize_t r = write(g_wakeFd, &one, sizeof(one));   // Wake epoll_wait (async-signal-safe)
+    (void)r;
+}
+
+class QueryServer {
+private:
+    struct Connection {
+        int fd = -1;
+        uint64_t id = 0;          // Distinguishes reuses of the same fd
+        std::string in;           // Received bytes not yet consumed
+        std::string out;          // Encoded responses not yet written
+        size_t outOff = 0;
+        bool busy = false;        // A request is being answered by a worker
+        bool peerClosed = false;  // Client sent EOF: close once its answers are written
+        bool reading = true;      // EPOLLIN is registered (off while 'in' is full or after EOF)
+        bool wantWrite = false;   // EPOLLOUT is registered
+    };
+
+    struct Job {
+        int fd;
+        uint64_t id;
+        std::string payload;      // Request, then response
+    };
+
+    Dataset& ds;
+    OutputFormat format;          // Result format unless a query asks for another
+    int listenFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1;              // eventfd: workers (and signals) wake the event loop
+    uint64_t nextId = 1;
+    Vector<Connection*> conns;    // Indexed by fd
+
+    std::mutex mtx;
+    std::condition_variable jobReady;
+    std::deque<Job> jobs;         // Waiting for a worker
+    std::deque<Job> done;         // Answered, waiting for the event loop
+    bool stopping = false;
+    Vector<std::thread*> workers;
+
+    void watch(int fd, uint32_t events, int op) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        epoll_ctl(epollFd, op, fd, &ev);
+    }
+
+    Connection* connFor(int fd) {
+        return (fd >= 0 && static_cast<size_t>(fd) < conns.size()) ? conns[fd] : nullptr;
+    }
+
+    void closeConnection(Connection* c) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, c->fd, nullptr);
+        close(c->fd);
+        conns[c->fd] = nullptr;
+        delete c;
+    }
+
+    void acceptAll() {
+        while (true) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return;      // EAGAIN: no more pending connections
+            while (conns.size() <= static_cast<size_t>(fd)) conns.push_back(nullptr);
+            Connection* c = new Connection();
+            c->fd = fd;
+            c->id = nextId++;
+            conns[fd] = c;
+            watch(fd, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_ADD);
+        }
+    }
+
+    // Register the events the connection waits for now: input while there is room
+    // for it and the client has not closed, output while responses are pending
+    void updateWatch(Connection* c) {
+        bool reading = !c->peerClosed && c->in.size() < MAX_BUFFERED;
+        bool writing = !c->out.empty();
+        if (reading == c->reading && writing == c->wantWrite) return;
+        c->reading = reading;
+        c->wantWrite = writing;
+        uint32_t events = 0;
+        if (reading) events |= EPOLLIN | EPOLLRDHUP;
+        if (writing) events |= EPOLLOUT;
+        watch(c->fd, events, EPOLL_CTL_MOD);
+    }
+
+    // Write as much pending output as the socket takes; false if the connection died
+    bool flush(Connection* c) {
+        while (c->outOff < c->out.size()) {
+            ssize_t n = write(c->fd, c->out.data() + c->outOff, c->out.size() - c->outOff);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                if (errno == EINTR) continue;
+                return false;
+            }
+            c->outOff += static_cast<size_t>(n);
+        }
+        if (c->outOff == c->out.size()) {
+            c->out.clear();
+            c->outOff = 0;
+        }
+        return true;
+    }
+
+    // Hand the next complete request of this connection to the workers; false on protocol error
+    bool dispatch(Connection* c) {
+        if (c->busy || c->in.size() < 4) return true;
+        uint32_t len = frameLength(c->in.data());
+        if (len > MAX_FRAME) return false;
+        if (c->in.size() < 4 + static_cast<size_t>(len)) return true;
+
+        Job job;
+        job.fd = c->fd;
+        job.id = c->id;
+        job.payload.assign(c->in, 4, len);
+        c->in.erase(0, 4 + static_cast<size_t>(len));
+        c->busy = true;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            jobs.push_back(std::move(job));
+        }
+        jobReady.notify_one();
+        return true;
+    }
+
+    // Write, start the next request and update the watched events after any progress.
+    // false when the connection should be closed: on an error, or once a client
+    // that sent EOF has all its answers (a partial last frame is dropped).
+    bool advance(Connection* c) {
+        if (!flush(c) || !dispatch(c)) return false;
+        updateWatch(c);
+        return !(c->peerClosed && !c->busy && c->out.empty());
+    }
+
+    void readFrom(Connection* c) {
+        char buf[64 * 1024];
+        while (c->in.size() < MAX_BUFFERED) {
+            ssize_t n = read(c->fd, buf, sizeof(buf));
+            if (n > 0) {
+                c->in.append(buf, static_cast<size_t>(n));
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            if (n < 0) {
+                closeConnection(c);   // Error
+                return;
+            }
+            c->peerClosed = true;     // EOF: the requests already received are still answered
+            break;
+        }
+        if (!advance(c)) closeConnection(c);
+    }
+
+    // Move finished responses into their connections' output buffers
+    void collectDone() {
+        std::deque<Job> finished;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            finished.swap(done);
+        }
+        for (size_t i = 0; i < finished.size(); ++i) {
+            Connection* c = connFor(finished[i].fd);
+            if (!c || c->id != finished[i].id) continue;   // Client went away meanwhile
+            appendFrame(c->out, finished[i].payload);
+            c->busy = false;
+            if (!advance(c)) closeConnection(c);
+        }
+    }
+
+    void workerLoop() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                jobReady.wait(lock, [&] { return stopping || !jobs.empty(); });
+                if (stopping) return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job.payload = answerRequest(ds, job.payload, format);
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                done.push_back(std::move(job));
+            }
+            uint64_t one = 1;
+            ssize_t r = write(wakeFd, &one, sizeof(one));
+            (void)r;
+        }
+    }
+
+public:
+    QueryServer(Dataset& d, OutputFormat fmt) : ds(d), format(fmt) {}
+
+    ~QueryServer() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i]->join();
+            delete workers[i];
+        }
+        for (size_t i = 0; i < conns.size(); ++i) {
+            if (conns[i]) closeConnection(conns[i]);
+        }
+        if (listenFd >= 0) close(listenFd);
+        if (epollFd >= 0) close(epollFd);
+        if (wakeFd >= 0) close(wakeFd);
+    }
+
+    // Bind the socket and start the workers (throws on failure)
+    void start(const std::string& path, size_t workerCount) {
+        sockaddr_un addr{};
+        if (path.size() >= sizeof(addr.sun_path)) throw std::runtime_error("socket path too long");
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+        listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd < 0) throw std::runtime_error("socket() failed");
+        unlink(path.c_str());        // Remove a stale socket file from an earlier run
+        if (bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listenFd, 128) < 0) {
+            throw std::runtime_error("cannot listen on " + path);
+        }
+
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epollFd < 0 || wakeFd < 0) throw std::runtime_error("epoll/eventfd setup failed");
+        watch(listenFd, EPOLLIN, EPOLL_CTL_ADD);
+        watch(wakeFd, EPOLLIN, EPOLL_CTL_ADD);
+        g_wakeFd = wakeFd;
+
+        for (size_t i = 0; i < workerCount; ++i) {
+            workers.push_back(new std::thread([this] { workerLoop(); }));
+        }
+    }
+
+    // Event loop; returns after SIGINT/SIGTERM
+    void run() {
+        epoll_event events[128];
+        while (!g_stopServer) {
+            int n = epoll_wait(epollFd, events, 128, -1);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("epoll_wait failed");
+            }
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == listenFd) {
+                    acceptAll();
+                }
+                else if (fd == wakeFd) {
+                    uint64_t count;
+                    ssize_t r = read(wakeFd, &count, sizeof(count));
+                    (void)r;
+                    collectDone();
+                }
+                else if (Connection* c = connFor(fd)) {
+                    if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                        closeConnection(c);
+                        continue;
+                    }
+                    if ((events[i].events & EPOLLOUT) && !advance(c)) {
+                        closeConnection(c);
+                        continue;
+                    }
+                    if (events[i].events & (EPOLLIN | EPOLLRDHUP)) readFrom(c);
+                }
+            }
+        }
+    }
+};
+
+static int runServer(Dataset& ds, const std::string& path, size_t workerCount, OutputFormat fmt) {
+    QueryServer server(ds, fmt);
+    try {
+        server.start(path, workerCount);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Server error: " << e.what() << "\n";
+        return 1;
+    }
+    std::signal(SIGINT, onStopSignal);
+    std::signal(SIGTERM, onStopSignal);
+    std::signal(SIGPIPE, SIG_IGN);
+    std::cerr << "[server] listening on " << path << " with " << workerCount << " workers\n";
+    server.run();
+    unlink(path.c_str());
+    std::cerr << "[server] stopped\n";
+    return 0;
+}
+
+// === Load generator for the query server ===
+static bool writeAll(int fd, const char* p, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+static bool readAll(int fd, char* p, size_t n) {
+    while (n > 0) {
+        ssize_t r = read(fd, p, n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        p += r;
+        n -= static_cast<size_t>(r);
+    }
+    return true;
+}
+
+static int connectTo(const std::string& path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) return -1;
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Replay the queries of 'queryFile' over 'connections' parallel connections until
+// 'requests' answers arrived; report throughput and latency percentiles
+static int runClient(const std::string& path, const std::string& queryFile,
+    size_t connections, size_t requests)
+{
+    Vector<std::string> queries;
+    std::ifstream in(queryFile);
+    if (!in) {
+        std::cerr << "Cannot open " << queryFile << "\n";
+        return 1;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line[line.size() - 1] == '\r') line.pop_back();
+        size_t p = line.find_first_not_of(" \t");
+        if (p == std::string::npos || line[p] == '#') continue;
+        if (line.size() > MAX_FRAME) {
+            std::cerr << "Query of " << line.size() << " bytes in " << queryFile << " exceeds the " << MAX_FRAME << "-byte frame limit\n";
+            return 1;
+        }
+        queries.push_back(line);
+    }
+    if (queries.empty()) {
+        std::cerr << "No queries in " << queryFile << "\n";
+        return 1;
+    }
+    if (connections == 0) connections = 1;
+
+    std::atomic<size_t> nextRequest{ 0 };
+    std::atomic<size_t> errors{ 0 };
+    std::atomic<size_t> failedConnections{ 0 };
+    Vector<Vector<double>> latencies;   // Per connection, milliseconds
+    for (size_t i = 0; i < connections; ++i) latencies.push_back(Vector<double>());
+
+    auto t0 = std::chrono::steady_clock::now();
+    Vector<std::thread*> threads;
+    for (size_t t = 0; t < connections; ++t) {
+        threads.push_back(new std::thread([&, t] {
+            int fd = connectTo(path);
+            if (fd < 0) {
+                failedConnections++;
+                return;
+            }
+            std::string frame, reply;
+            while (true) {
+                size_t r = nextRequest.fetch_add(1);
+                if (r >= requests) break;
+                frame.clear();
+                appendFrame(frame, queries[r % queries.size()]);
+                auto s0 = std::chrono::steady_clock::now();
+                char hdr[4];
+                if (!writeAll(fd, frame.data(), frame.size()) || !readAll(fd, hdr, 4)) {
+                    errors++;
+                    break;
+                }
+                uint32_t len = frameLength(hdr);
+                if (len > MAX_REPLY_FRAME) {
+                    errors++;                   // Corrupt or hostile length: drop the connection
+                    break;
+                }
+                reply.resize(len);
+                if (!readAll(fd, &reply[0], reply.size())) {
+                    errors++;
+                    break;
+                }
+                auto s1 = std::chrono::steady_clock::now();
+                latencies[t].push_back(std::chrono::duration<double, std::milli>(s1 - s0).count());
+                if (reply.empty() || reply[0] != '0') errors++;
+            }
+            close(fd);
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); ++t) {
+        threads[t]->join();
+        delete threads[t];
+    }
+    double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    Vector<double> all;
+    for (size_t t = 0; t < latencies.size(); ++t) {
+        for (size_t i = 0; i < latencies[t].size(); ++i) all.push_back(latencies[t][i]);
+    }
+    if (failedConnections > 0) {
+        std::cerr << "[client] " << failedConnections << " connections to " << path << " failed\n";
+    }
+    size_t n = all.size();
+    std::cout << "[client] " << n << " requests over " << connections << " connections, "
+        << errors << " errors, " << totalMs << " ms";
+    if (n > 0) {
+        std::sort(all.begin(), all.end());
+        std::cout << ", " << (n * 1000.0 / totalMs) << " QPS"
+            << ", p50=" << all[n / 2] << " ms"
+            << ", p99=" << all[(n * 99) / 100 < n ? (n * 99) / 100 : n - 1] << " ms"
+            << ", max=" << all[n - 1] << " ms";
+    }
+    std::cout << "\n";
+    return (n > 0 && failedConnections == 0) ? 0 : 1;
+}
+
+#endif // __linux__
+
+// === Pipeline benchmark ===
+// --bench DIR[,DIR...] loads each dataset directory (e.g. DataGenerator output at
+// different sizes) with every load step measured, then replays a scripted mix of
+// the six menu query kinds against it. One row per phase: wall time, peak RSS and
+// operator-new calls/bytes, as text or as csv/jsonl records (--format).
+
+// Query lines of one menu kind; the whole list runs as one measured phase
+struct BenchQueryKind {
+    const char* phase;
+    Vector<std::string> lines;
+};
+
+// Leading bytes of a name, extended so a UTF-8 sequence is never cut in half
+static std::string namePrefix(const std::string& name, size_t len) {
+    while (len < name.size() && (static_cast<unsigned char>(name[len]) & 0xC0) == 0x80) ++len;
+    return len < name.size() ? name.substr(0, len) : name;
+}
+
+// Menu options 1–6 as batch queries, derived from 'samples' municipalities spread
+// evenly over the DFS order (so the mix is deterministic for a given dataset)
+static Vector<BenchQueryKind> benchQueries(const Dataset& ds, size_t samples) {
+    static const char* const PHASES[] = {
+        "query:name", "query:maxPop", "query:minPop", "query:navigate", "query:search", "query:filter"
+    };
+    Vector<BenchQueryKind> kinds;
+    for (const char* p : PHASES) kinds.push_back(BenchQueryKind{ p, Vector<std::string>() });
+
+    const NodeList& munis = ds.levels[levelIndex("Municipality")];
+    const std::string& yr = YEARS[YEARS.size() - 1];
+    size_t n = munis.size() < samples ? munis.size() : samples;
+    for (size_t i = 0; i < n; ++i) {
+        const HierarchyNode* m = munis[i * munis.size() / n];
+        const TerritorialUnit& u = m->unit;
+        std::string pop = std::to_string(unitPopulation(u, yr));
+        std::string parent = m->parent ? m->parent->unit.code : "AT";
+
+        kinds[0].lines.push_back("flat year=" + yr + " name=\"" + namePrefix(u.name, 4) + "\"");
+        kinds[1].lines.push_back("flat year=" + yr + " max=" + pop);
+        kinds[2].lines.push_back("flat year=" + yr + " min=" + pop);
+        kinds[3].lines.push_back("children code=" + parent);
+        kinds[3].lines.push_back("summary code=" + u.code);
+        kinds[4].lines.push_back("search type=Municipality name=\"" + u.name + "\"");
+        kinds[5].lines.push_back("filter subtree=" + parent + " year=" + yr + " min=" + pop + " sort=pop top=20");
+    }
+    return kinds;
+}
+
+static void printPhase(ResultWriter& out, const std::string& dir, size_t units, const PhaseSample& s) {
+    if (out.isText()) {
+        out << "  " << s.name << ": " << s.ms << " ms, peak RSS " << s.peakRssKb
+            << " KB, allocs " << s.allocs << " (" << s.allocBytes << " bytes)";
+        if (s.ops) out << ", " << s.ops << " queries";
+        out << "\n";
+        return;
+    }
+    out.beginRecord();
+    out.field("dataset", dir);
+    out.field("units", units);
+    out.field("phase", s.name);
+    out.field("ms", s.ms);
+    out.field("peak_rss_kb", s.peakRssKb);
+    out.field("allocs", s.allocs);
+    out.field("alloc_bytes", s.allocBytes);
+    out.field("ops", s.ops);
+    out.endRecord();
+}
+
+// Load and query every directory in 'dirs' in turn; 'rounds' repetitions of the query mix
+static int runBench(const Vector<std::string>& dirs, size_t rounds, size_t cacheEntries,
+    bool useArena, bool compress, OutputFormat fmt)
+{
+    const size_t SAMPLES = 16;
+    ResultWriter out(std::cout, fmt);
+    for (size_t d = 0; d < dirs.size(); ++d) {
+        PhaseLog log;
+        size_t units = 0;
+        size_t errors = 0;
+        {
+            // Arena before dataset: the dataset's destructor still uses the arena's memory
+            MonotonicArena arena(1 << 20);
+            if (useArena) MonotonicArena::setCurrent(&arena);
+            Dataset ds;
+            ds.compress = compress;
+            try {
+                loadDataset(ds, dirs[d], &log);
+            }
+            catch (const std::exception& e) {
+                MonotonicArena::setCurrent(nullptr);
+                out.flush();
+                std::cerr << "Fatal error (" << dirs[d] << "): " << e.what() << "\n";
+                return 1;
+            }
+            MonotonicArena::setCurrent(nullptr);
+            ds.resultCache.setCapacity(cacheEntries);
+            units = ds.dfsOrder.size();
+
+            Vector<BenchQueryKind> kinds = benchQueries(ds, SAMPLES);
+            ResultWriter discard(OutputFormat::Text);   // Results are produced, then dropped
+            for (size_t k = 0; k < kinds.size(); ++k) {
+                Vector<Query> queries;
+                for (size_t i = 0; i < kinds[k].lines.size(); ++i) {
+                    Query q;
+                    if (parseQuery(kinds[k].lines[i], q)) queries.push_back(q);
+                }
+                PhaseLog::Scope phase(&log, kinds[k].phase, rounds * queries.size());
+                for (size_t r = 0; r < rounds; ++r) {
+                    for (size_t i = 0; i < queries.size(); ++i) {
+                        try {
+                            runQuery(ds, queries[i], discard);
+                        }
+                        catch (const std::exception&) {
+                            ++errors;
+                        }
+                        discard.clear();
+                    }
+                }
+            }
+        }
+
+        // Load steps, their total, then the query phases
+        const Vector<PhaseSample>& samples = log.all();
+        PhaseSample load;
+        load.name = "load";
+        if (out.isText()) out << "=== " << dirs[d] << " (" << units << " units) ===\n";
+        for (size_t i = 0; i < samples.size(); ++i) {
+            const PhaseSample& s = samples[i];
+            if (s.ops) continue;
+            printPhase(out, dirs[d], units, s);
+            load.ms += s.ms;
+            load.allocs += s.allocs;
+            load.allocBytes += s.allocBytes;
+            if (s.peakRssKb > load.peakRssKb) load.peakRssKb = s.peakRssKb;
+        }
+        printPhase(out, dirs[d], units, load);
+        for (size_t i = 0; i < samples.size(); ++i) {
+            if (samples[i].ops) printPhase(out, dirs[d], units, samples[i]);
+        }
+        out.flush();
+        if (errors) std::cerr << "[bench] " << dirs[d] << ": " << errors << " queries failed\n";
+    }
+    return 0;
+}
+
+// --stats report as JSON lines: the measured load phases, the allocation counters,
+// the hash tables and population columns of the dataset (if loaded) and, in
+// SP_STATS builds, the instrumentation counters and timers
+static void writeStatsReport(const PhaseLog& phases, Dataset* ds, std::ostream& os) {
+    ResultWriter out(os, OutputFormat::Jsonl);
+    const Vector<PhaseSample>& samples = phases.all();
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const PhaseSample& s = samples[i];
+        out.beginRecord();
+        out.field("kind", "phase");
+        out.field("name", s.name);
+        out.field("ms", s.ms);
+        out.field("peak_rss_kb", s.peakRssKb);
+        out.field("allocs", s.allocs);
+        out.field("alloc_bytes", s.allocBytes);
+        out.endRecord();
+    }
+    out.beginRecord();
+    out.field("kind", "counter");
+    out.field("name", "allocations");
+    out.field("value", g_newCalls.load());
+    out.endRecord();
+    out.beginRecord();
+    out.field("kind", "counter");
+    out.field("name", "alloc_bytes");
+    out.field("value", g_newBytes.load());
+    out.endRecord();
+    if (ds) {
+        out.newResultSet();
+        runTablesQuery(*ds, out, true);
+        out.newResultSet();
+        runColumnsQuery(*ds, out, true);
+    }
+    if (stats::ENABLED) {
+        stats::report(out);
+    }
+    out.flush();
+    os.flush();
+}
+
+// Report allocation counters (global operator new, container heap, dataset arena)
+static void printAllocStats(const char* phase, const MonotonicArena& arena) {
+    std::cerr << "[alloc] " << phase << "\n"
+        << "  operator new:    calls=" << g_newCalls.load()
+        << ", bytes=" << g_newBytes.load() << "\n"
+        << "  container heap:  allocs=" << HeapAllocator::stats().allocations.load()
+        << ", frees=" << HeapAllocator::stats().deallocations.load()
+        << ", bytes=" << HeapAllocator::stats().bytes.load() << "\n"
+        << "  dataset arena:   allocs=" << arena.allocationCount()
+        << ", used=" << arena.bytesUsed()
+        << ", reserved=" << arena.bytesReserved()
+        << ", chunks=" << arena.chunkCount() << "\n";
+}
+
+int main(int argc, char** argv) {
+#ifdef _MSC_VER
+    _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF); // Enable heap leak checking
+#endif
+#ifdef _WIN32
+    // Ensure UTF-8 console on Windows (for diacritics support)
+    SetConsoleOutputCP(65001);
     SetConsoleCP(65001);
 #endif
 
-    // ==== 1) Build hierarchy & load populations ====
-    HierarchyNode* root = nullptr;
-    try {
-        // (1) Load region hierarchy from "country.csv"
-        root = loadRegions("country.csv");
+    // Command-line switches
+    bool useArena = false;     // --arena: build the whole dataset inside one MonotonicArena
+    bool compress = false;     // --compress: keep the populations only as packed columns
+    bool allocStats = false;   // --alloc-stats: print allocation counters after loading
+    std::string batchFile;     // --batch FILE: run the queries in FILE ("-" for stdin), no menu
+    std::string servePath;     // --serve PATH: answer queries on a Unix domain socket
+    std::string clientPath;    // --client PATH: load-generate against a running server
+    std::string queryFile;     // --queries FILE: query lines replayed by --client
+    size_t workers = std::thread::hardware_concurrency();  // --workers N (server)
+    size_t connections = 4;    // --connections N (client)
+    size_t requests = 10000;   // --requests N (client)
+    size_t threads = std::thread::hardware_concurrency();  // --threads N: cores per query (1 = sequential)
+    size_t cacheEntries = 256; // --result-cache N: cached filter answers (0 = off)
+    std::string benchDirs;     // --bench DIR[,DIR...]: measure load and query phases per dataset
+    size_t benchRounds = 20;   // --bench-rounds N: repetitions of the benchmark query mix
+    bool printStats = false;   // --stats: write the instrumentation report to stderr on exit
+    bool verbose = false;      // --verbose: a latency line per batch query on stderr
+    std::string statsFile;     // --stats-file FILE: ... or to FILE
+    OutputFormat format = OutputFormat::Text;  // --format text|csv|jsonl (batch and server results)
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--arena")            useArena = true;
+        else if (arg == "--compress")    compress = true;
+        else if (arg == "--alloc-stats") allocStats = true;
+        else if (arg == "--stats")       printStats = true;
+        else if (arg == "--verbose")     verbose = true;
+        else if (arg == "--stats-file" && hasValue)  statsFile = argv[++i];
+        else if (arg == "--batch" && hasValue)       batchFile = argv[++i];
+        else if (arg == "--serve" && hasValue)       servePath = argv[++i];
+        else if (arg == "--client" && hasValue)      clientPath = argv[++i];
+        else if (arg == "--queries" && hasValue)     queryFile = argv[++i];
+        else if (arg == "--workers" && hasValue)     workers = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--connections" && hasValue) connections = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--requests" && hasValue)    requests = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--threads" && hasValue)     threads = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--result-cache" && hasValue) cacheEntries = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--bench" && hasValue)       benchDirs = argv[++i];
+        else if (arg == "--bench-rounds" && hasValue) benchRounds = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--format" && hasValue) {
+            if (!parseOutputFormat(argv[++i], format)) {
+                std::cerr << "Unknown format '" << argv[i] << "' (text, csv or jsonl)\n";
+                return 1;
+            }
+        }
+    }
+    if (workers == 0) workers = 1;
+
+    PhaseLog loadPhases;
+    Dataset* statsDataset = nullptr;   // Tables included in the report once loaded
+    bool wantStats = printStats || !statsFile.empty();
+    if (wantStats && !stats::ENABLED) {
+        std::cerr << "[stats] built without SP_STATS: only phases and allocation counters are reported\n";
+    }
+    auto reportStats = [&]() {
+        if (!statsFile.empty()) {
+            std::ofstream f(statsFile);
+            if (!f) std::cerr << "Cannot write " << statsFile << "\n";
+            else writeStatsReport(loadPhases, statsDataset, f);
+        }
+        else if (printStats) {
+            writeStatsReport(loadPhases, statsDataset, std::cerr);
+        }
+    };
+
+#ifdef __linux__
+    // The load generator needs no dataset of its own
+    if (!clientPath.empty()) {
+        return runClient(clientPath, queryFile, connections, requests);
+    }
+#else
+    if (!clientPath.empty() || !servePath.empty()) {
+        std::cerr << "--serve/--client need Unix domain sockets and epoll (Linux only)\n";
+        return 1;
+    }
+#endif
 
-        // (2) Build lookup table: code → HierarchyNode*
-        HashMap<std::string, HierarchyNode*> lookup;
-        buildLookup(root, lookup);
+    // Large scans and sorts are split across the pool; the querying thread works too
+    std::unique_ptr<ThreadPool> queryPool;
+    if (threads > 1) {
+        queryPool.reset(new ThreadPool(threads - 1));
+        ThreadPool::setCurrent(queryPool.get());
+    }
 
-        // (3) Load municipalities and attach to regions
-        loadMunicipalities("municipalities.csv", lookup);
+    // Benchmark mode loads its own datasets, one after the other
+    if (!benchDirs.empty()) {
+        Vector<std::string> dirs;
+        size_t start = 0;
+        while (start <= benchDirs.size()) {
+            size_t comma = benchDirs.find(',', start);
+            if (comma == std::string::npos) comma = benchDirs.size();
+            dirs.push_back(benchDirs.substr(start, comma - start));
+            start = comma + 1;
+        }
+        int rc = runBench(dirs, benchRounds, cacheEntries, useArena, compress, format);
+        reportStats();
+        return rc;
+    }
 
-        // (4) Load population data for each year
-        loadPopData(YEARS, lookup);
+    // Declared first so it is destroyed last: its destructor frees the whole dataset in one call
+    MonotonicArena datasetArena(1 << 20);
+    if (useArena) {
+        MonotonicArena::setCurrent(&datasetArena);
+    }
 
-        // (5) Accumulate population counts upward through hierarchy
-        accumulate(root);
+    // ==== 1) Build hierarchy, load populations & search tables ====
+    Dataset ds;
+    ds.compress = compress;
+    try {
+        loadDataset(ds, "", wantStats ? &loadPhases : nullptr);
     }
     catch (const std::exception& e) {
         std::cerr << "Fatal error: " << e.what() << "\n";
-        delete root;                      // Clean up if error occurs
-        return 1;
+        return 1;                         // ~Dataset cleans up what was built
     }
+    HierarchyNode* root = ds.root;
+    ds.resultCache.setCapacity(cacheEntries);
+    statsDataset = &ds;
 
-    // ==== 2) Build Level 3 name/type search tables ====
-    HashMap<std::string, Vector<HierarchyNode*>> countryTable,
-        geoDivTable,
-        stateTable,
-        regionTable,
-        municipalityTable;
-    buildTables(root,
-        countryTable, geoDivTable,
-        stateTable, regionTable,
-        municipalityTable);
+    // Dataset is complete; later allocations go back to the heap
+    MonotonicArena::setCurrent(nullptr);
+    if (allocStats) {
+        printAllocStats(useArena ? "after loading (arena)" : "after loading (heap)", datasetArena);
+    }
+
+    // ==== 2) Batch mode: answer the query file and exit ====
+    if (!batchFile.empty()) {
+        std::ios::sync_with_stdio(false);
+        if (batchFile == "-") {
+            runBatch(ds, std::cin, format, verbose);
+        }
+        else {
+            std::ifstream in(batchFile);
+            if (!in) {
+                std::cerr << "Cannot open " << batchFile << "\n";
+                return 1;
+            }
+            runBatch(ds, in, format, verbose);
+        }
+        reportStats();
+        return 0;
+    }
+
+#ifdef __linux__
+    // ==== 2b) Server mode: answer socket queries until SIGINT/SIGTERM ====
+    if (!servePath.empty()) {
+        int rc = runServer(ds, servePath, workers, format);
+        reportStats();
+        return rc;
+    }
+#endif
 
     // ===== 3) Main interactive menu (Levels 1–4) =====
     int choice;
@@ -430,6 +4185,7 @@ int main() {
             << "/   LVL 2 - [4] Hierarchy: Navigate     /\n"
             << "/   LVL 3 - [5] Search by Type & Name   /\n"
             << "/   LVL 4 - [6] Filter+Sort from Subtree/\n"
+            << "/   [7] Cache statistics                /\n"
             << "/   [0] Exit                            /\n"
             << "/=======================================/\n"
             << "Choose: ";
@@ -437,57 +4193,33 @@ int main() {
 
         // ─── Levels 1–3: flat filters & hierarchy & type/name search ───
         if (choice >= 1 && choice <= 3) {
-            Vector<FlatMunicipality> flat;
             std::string yr;
             std::cout << "Year (2020–2024): ";
             std::cin >> yr;
-            loadFlat(yr + ".csv", flat);      // Load flat data for specified year
+            FlatCache::Rows yearData = ds.flatCache.get(yr); // Parsed once, then served from memory
+            const Vector<FlatMunicipality>& flat = yearData->rows;
 
+            Vector<uint32_t> rows;            // Indices of the matching rows in 'flat'
             if (choice == 1) {
                 // Filter by name substring
                 std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
                 std::cout << "Enter substring: ";
                 std::string sub;
                 std::getline(std::cin, sub);
-                for (size_t i = 0; i < sub.size(); ++i) {
-                    sub[i] = std::tolower(static_cast<unsigned char>(sub[i]));
-                }
-
-                auto res = filter(flat, [&](const FlatMunicipality& m) {
-                    std::string low = m.name;
-                    for (size_t j = 0; j < low.size(); ++j) {
-                        low[j] = std::tolower(static_cast<unsigned char>(low[j]));
-                    }
-                    return low.find(sub) != std::string::npos;
-                    });
-
-                if (res.size() == 0) {
-                    std::cout << "No matches.\n";
-                }
-                else {
-                    for (size_t i = 0; i < res.size(); ++i) {
-                        printFlat(res[i]);          // Print each matching municipality
-                    }
-                }
+                rows = selectRows(flat, NameContains(sub));
             }
             else {
                 // Filter by max/min total population
                 std::cout << "Enter number of people: ";
                 int thr;
                 std::cin >> thr;
-                auto res = filter(flat, [&](const FlatMunicipality& m) {
-                    int tot = m.male + m.female;
-                    return (choice == 2) ? (tot <= thr) : (tot >= thr);
-                    });
-                if (res.size() == 0) {
-                    std::cout << "No matches.\n";
-                }
-                else {
-                    for (size_t i = 0; i < res.size(); ++i) {
-                        printFlat(res[i]);          // Print each matching municipality
-                    }
-                }
+                // Binary search in the year's population index (rows stay in file order)
+                if (choice == 2) rows = flatRange(*yearData, INT_MIN, thr, false);
+                else             rows = flatRange(*yearData, thr, INT_MAX, false);
             }
+
+            ResultWriter out(std::cout);
+            printFlatResults(flat, rows, out);
         }
         else if (choice == 4) {
             // Hierarchy: Navigate through the tree (Level 2 functionality)
@@ -540,32 +4272,8 @@ int main() {
             std::string nm;
             std::getline(std::cin, nm);
 
-            HashMap<std::string, Vector<HierarchyNode*>>* tbl = nullptr;
-            if (tp == "Country")         tbl = &countryTable;
-            else if (tp == "GeoDiv")     tbl = &geoDivTable;
-            else if (tp == "State")      tbl = &stateTable;
-            else if (tp == "Region")     tbl = &regionTable;
-            else if (tp == "Municipality") tbl = &municipalityTable;
-
-            if (!tbl) {
-                std::cout << "Invalid type.\n";
-            }
-            else {
-                Vector<HierarchyNode*>* vecPtr = tbl->find(nm);
-                if (vecPtr == nullptr) {
-                    std::cout << "No " << tp << " named \"" << nm << "\".\n";
-                }
-                else {
-                    for (size_t i = 0; i < vecPtr->size(); ++i) {
-                        HierarchyNode* ptr = (*vecPtr)[i];
-                        std::cout << "\n[Search Result] "
-                            << ptr->unit.type << " "
-                            << ptr->unit.name << " ("
-                            << ptr->unit.code << ")\n";
-                        printSummary(ptr->unit);   // Show population summary
-                    }
-                }
-            }
+            ResultWriter out(std::cout);
+            printSearchResults(ds.tableFor(tp), tp, nm, out);
         }
         else if (choice == 6) {
             // Filter + Sort from chosen Subtree (Level 4 functionality)
@@ -573,40 +4281,48 @@ int main() {
             HierarchyNode* subRoot = chooseSubtree(root); // Let user pick a subtree root
             if (!subRoot) continue;
 
-            // 1) Flatten the subtree into a Vector<TerritorialUnit>
-            Vector<TerritorialUnit> items;
-            flattenSubtree(subRoot, items);
+            // 1) The subtree is a slice of the DFS order (no copies of TerritorialUnit)
+            Span<HierarchyNode* const> nodes = subtreeRange(ds.dfsOrder, subRoot);
 
             // 2) Ask the user which filter to apply (name substring, max or min pop)
             std::cout << "Filter by:\n"
                 << "  1) Name substring\n"
                 << "  2) Max population\n"
                 << "  3) Min population\n"
+                << "  4) Min growth (%) between two years\n"
+                << "  5) Compound expression\n"
                 << "Choice: ";
             int fchoice;
             std::cin >> fchoice;
 
-            // Build filter predicate (std::function<bool(const TerritorialUnit&)>)
-            std::function<bool(const TerritorialUnit&)> pred;
+            Vector<const TerritorialUnit*> filtered;  // Pointers to the matching units
             std::string yr;     // Will hold year for pop filters
             std::string sub;    // Substring for name filter
             int thr;            // Threshold for pop filter
+            GrowthCache::Columns growth;   // Set by the growth filter or sort
+
+            // Growth columns for two years asked from the user (nullptr for a year without data)
+            auto askGrowth = [&]() -> GrowthCache::Columns {
+                std::string from, to;
+                std::cout << "From year: ";
+                std::cin >> from;
+                std::cout << "To year: ";
+                std::cin >> to;
+                try {
+                    return ds.growthCache.get(from, to);
+                }
+                catch (const std::exception& e) {
+                    std::cout << e.what() << "\n";
+                    return nullptr;
+                }
+            };
 
             if (fchoice == 1) {
                 // Name substring filter
                 std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
                 std::cout << "Enter substring: ";
                 std::getline(std::cin, sub);
-                for (size_t i = 0; i < sub.size(); ++i) {
-                    sub[i] = std::tolower(static_cast<unsigned char>(sub[i]));
-                }
-                pred = [&](auto& u) {
-                    std::string low = u.name;
-                    for (size_t j = 0; j < low.size(); ++j) {
-                        low[j] = std::tolower(static_cast<unsigned char>(low[j]));
-                    }
-                    return low.find(sub) != std::string::npos;
-                };
+                filtered = selectUnits(nodes, NameContains(sub));
             }
             else if (fchoice == 2 || fchoice == 3) {
                 // Max or Min population filter
@@ -614,25 +4330,48 @@ int main() {
                 std::cin >> yr;
                 std::cout << "Number of people: ";
                 std::cin >> thr;
-                pred = [&](auto& u) {
-                    auto it = u.popByYear.find(yr);
-                    int m = 0, f = 0;
-                    if (it != u.popByYear.end()) {
-                        m = it->second.first;
-                        f = it->second.second;
-                    }
-                    int tot = m + f;
-                    // Return true if total ≤ thr (max) or total ≥ thr (min)
-                    return (fchoice == 2) ? (tot <= thr) : (tot >= thr);
-                };
+                size_t y = PopColumns::yearIndex(yr);
+                if (y < YEARS.size()) {
+                    // Binary search in the population index, back in DFS order for the sort below
+                    filtered = indexedSelect(ds.popIndex, ds.columns, ds.dfsOrder, ds.levels, subRoot, y, LEVEL_COUNT, Sex::Total,
+                        fchoice == 2 ? INT_MIN : thr, fchoice == 2 ? thr : INT_MAX);
+                    sortByDfs(filtered);
+                }
+                else if (fchoice == 2) filtered = selectUnits(nodes, PopulationAtMost(yr, thr));
+                else                   filtered = selectUnits(nodes, PopulationAtLeast(yr, thr));
+            }
+            else if (fchoice == 4) {
+                // Growth filter: change in percent of the first year's population
+                growth = askGrowth();
+                if (!growth) continue;
+                std::cout << "Minimum change (%): ";
+                double minPct;
+                std::cin >> minPct;
+                filtered = selectUnits(nodes, GrowthWithin(growth.get(), GrowthMetric::Pct,
+                    minPct, std::numeric_limits<double>::infinity()));
+            }
+            else if (fchoice == 5) {
+                // AND/OR of several predicates, ordered by the planner
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                std::cout << "Expression (e.g. type=Municipality & pop@2024>=5000 & !name~berg): ";
+                std::string expr;
+                std::getline(std::cin, expr);
+                try {
+                    CompoundFilter where(ds, expr, YEARS[YEARS.size() - 1], nullptr, "");
+                    std::string plan;
+                    filtered = where.select(ds, subRoot, &plan);
+                    std::cout << "[Plan] " << plan << "\n";
+                }
+                catch (const std::exception& e) {
+                    std::cout << e.what() << "\n";
+                    continue;
+                }
             }
             else {
                 std::cout << "Invalid filter choice.\n";
                 continue;
             }
 
-            // Apply filter to flattened items
-            Vector<TerritorialUnit> filtered = filter(items, pred);
             if (filtered.size() == 0) {
                 std::cout << "No matches.\n";
                 continue;
@@ -642,25 +4381,22 @@ int main() {
             std::cout << "Sort by:\n"
                 << "  1) Alphabet\n"
                 << "  2) Population\n"
-                << "Choice: ";
+                << "  3) Growth\n"
+                << "Choice (optionally followed by how many to show, e.g. \"2 10\"): ";
             int sortChoice;
             std::cin >> sortChoice;
+            // The rest of the line may hold a limit (none: show all)
+            size_t limit = 0;
+            std::string rest;
+            std::getline(std::cin, rest);
+            std::istringstream(rest) >> limit;
 
-            // 'sex' remains in scope for comparator and printing (male/female/total)
+            // 'sex' remains in scope for printing (male/female/total)
             std::string sex;
 
-            // Build sort comparator: std::function<int(const TerritorialUnit&, const TerritorialUnit&)>
-            std::function<int(const TerritorialUnit&, const TerritorialUnit&)> cmp;
+            // 4) Sort the selected pointers (with a limit: only the first 'limit', via a bounded heap)
             if (sortChoice == 1) {
-                std::locale loc(""); // Use environment's default locale
-                cmp = [&](auto& a, auto& b) {
-                    const std::string& sa = a.name;
-                    const std::string& sb = b.name;
-                    int r = std::use_facet<std::collate<char>>(loc).compare(
-                        sa.data(), sa.data() + sa.size(),
-                        sb.data(), sb.data() + sb.size());
-                    return (r < 0 ? -1 : (r > 0 ? 1 : 0));
-                };
+                rankUnits(filtered, ByName(std::locale("")), false, limit); // Use environment's default locale
             }
             else if (sortChoice == 2) {
                 // Sort by population for a given year and sex
@@ -671,55 +4407,41 @@ int main() {
                 for (size_t i = 0; i < sex.size(); ++i) {
                     sex[i] = std::tolower(static_cast<unsigned char>(sex[i]));
                 }
-                cmp = [&](auto& a, auto& b) {
-                    auto ia = a.popByYear.find(yr);
-                    auto ib = b.popByYear.find(yr);
-                    int am = 0, af = 0, bm = 0, bf = 0;
-                    if (ia != a.popByYear.end()) { am = ia->second.first; af = ia->second.second; }
-                    if (ib != b.popByYear.end()) { bm = ib->second.first; bf = ib->second.second; }
-                    int va = (sex == "male" ? am : (sex == "female" ? af : (am + af)));
-                    int vb = (sex == "male" ? bm : (sex == "female" ? bf : (bm + bf)));
-                    return (va < vb ? -1 : (va > vb ? 1 : 0));
-                };
+                rankUnits(filtered, ByPopulation(yr, parseSex(sex)), false, limit);
+            }
+            else if (sortChoice == 3) {
+                // Sort by a growth metric (years already chosen by a growth filter are reused)
+                if (!growth) growth = askGrowth();
+                if (!growth) continue;
+                std::cout << "Metric (abs/pct/cagr): ";
+                std::string m;
+                std::cin >> m;
+                GrowthMetric metric;
+                if (!parseGrowthMetric(m, metric)) {
+                    std::cout << "Invalid metric.\n";
+                    continue;
+                }
+                rankUnits(filtered, ByGrowth(growth.get(), metric), false, limit);
             }
             else {
                 std::cout << "Invalid sort choice.\n";
                 continue;
             }
 
-            // 4) Sort the filtered list using insertion sort (stable, simple enough for small N)
-            for (size_t i = 1; i < filtered.size(); ++i) {
-                TerritorialUnit key = filtered[i];
-                size_t j = i;
-                while (j > 0 && cmp(key, filtered[j - 1]) < 0) {
-                    filtered[j] = filtered[j - 1];   // Shift element to the right
-                    --j;
-                }
-                filtered[j] = key;                   // Insert key at correct position
-            }
-
             // 5) Print sorted results to console
-            std::cout << "\n[Results]\n";
-            for (size_t i = 0; i < filtered.size(); ++i) {
-                auto& u = filtered[i];
-                std::cout << u.name << " (" << u.code << ")";
-                if (sortChoice == 2) {
-                    auto it = u.popByYear.find(yr);
-                    int m = 0, f = 0;
-                    if (it != u.popByYear.end()) {
-                        m = it->second.first;
-                        f = it->second.second;
-                    }
-                    int val = (sex == "male" ? m : (sex == "female" ? f : (m + f)));
-                    std::cout << ": " << yr << "-" << sex << "=" << val;
-                }
-                std::cout << "\n";
-            }
+            ResultWriter out(std::cout);
+            printUnitResults(filtered, sortChoice == 2, yr, sex, out, growth.get());
+        }
+        else if (choice == 7) {
+            ds.flatCache.printStats();
+            ResultWriter out(std::cout);
+            ds.resultCache.report(out);
         }
     } while (choice != 0);
+    reportStats();
 
     // ==== 4) Clean up entire tree ====
-    delete root; // Recursively deletes all nodes and children
+    // ~Dataset recursively deletes all nodes and children
 
     return 0;
 }
\ No newline at end of file
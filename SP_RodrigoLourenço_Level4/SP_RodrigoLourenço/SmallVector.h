@@ -0,0 +1,229 @@
+// SmallVector.h
+#ifndef SMALLVECTOR_H
+#define SMALLVECTOR_H
+
+#include <cstddef>
+#include <new>
+#include <cassert>
+#include <utility>
+#include "Allocator.h"
+
+// Same interface as Vector<T>, but the first N elements live inline inside
+// the object. Only when more than N elements are pushed does it move to the heap.
+template<typename T, size_t N, typename Alloc = HeapAllocator>
+class SmallVector : private Alloc {
+    static_assert(N > 0, "SmallVector needs at least one inline slot");
+
+private:
+    T* _data;
+    size_t _size = 0;
+    size_t _capacity = N;
+    alignas(T) unsigned char inlineBuf[N * sizeof(T)];
+
+    T* inlineData() { return reinterpret_cast<T*>(inlineBuf); }
+    bool isInline() const { return _data == reinterpret_cast<const T*>(inlineBuf); }
+
+    Alloc& allocator() { return *this; }
+
+    T* allocateN(size_t n) {
+        return static_cast<T*>(allocator().allocate(n * sizeof(T), alignof(T)));
+    }
+
+    // Destroy all elements and give back heap storage (if any)
+    void release() {
+        for (size_t i = 0; i < _size; ++i) {
+            _data[i].~T();
+        }
+        if (!isInline()) {
+            allocator().deallocate(_data, _capacity * sizeof(T), alignof(T));
+        }
+        _data = inlineData();
+        _size = 0;
+        _capacity = N;
+    }
+
+    // Move elements into a heap block of newCap slots, leaving slot _size free
+    T* grow(size_t newCap) {
+        T* newData = allocateN(newCap);
+        for (size_t j = 0; j < _size; ++j) {
+            new (&newData[j]) T(std::move(_data[j]));
+            _data[j].~T();
+        }
+        return newData;
+    }
+
+    void adopt(T* newData, size_t newCap) {
+        if (!isInline()) {
+            allocator().deallocate(_data, _capacity * sizeof(T), alignof(T));
+        }
+        _data = newData;
+        _capacity = newCap;
+    }
+
+    void copyFrom(const SmallVector& other) {
+        if (other._size > N) {
+            _data = allocateN(other._size);
+            _capacity = other._size;
+        }
+        for (size_t i = 0; i < other._size; ++i) {
+            new (&_data[i]) T(other._data[i]);
+        }
+        _size = other._size;
+    }
+
+    void moveFrom(SmallVector& other) {
+        if (other.isInline()) {
+            // Inline elements cannot be stolen, move them one by one
+            for (size_t i = 0; i < other._size; ++i) {
+                new (&_data[i]) T(std::move(other._data[i]));
+                other._data[i].~T();
+            }
+            _size = other._size;
+            other._size = 0;
+        }
+        else {
+            // Steal other's heap block (and the allocator that owns it)
+            allocator() = other.get_allocator();
+            _data = other._data;
+            _size = other._size;
+            _capacity = other._capacity;
+            other._data = other.inlineData();
+            other._size = 0;
+            other._capacity = N;
+        }
+    }
+
+public:
+    // Plain pointers are random-access iterators
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    SmallVector() : _data(inlineData()) {}
+    explicit SmallVector(const Alloc& a) : Alloc(a), _data(inlineData()) {}
+
+    // Copy constructor (uses a copy of other's allocator)
+    SmallVector(const SmallVector& other) : Alloc(other.get_allocator()), _data(inlineData()) {
+        copyFrom(other);
+    }
+
+    // Copy assignment
+    SmallVector& operator=(const SmallVector& other) {
+        if (this == &other) return *this;
+        release();
+        copyFrom(other);
+        return *this;
+    }
+
+    // Move constructor
+    SmallVector(SmallVector&& other) noexcept : Alloc(other.get_allocator()), _data(inlineData()) {
+        moveFrom(other);
+    }
+
+    // Move assignment
+    SmallVector& operator=(SmallVector&& other) noexcept {
+        if (this == &other) return *this;
+        release();
+        moveFrom(other);
+        return *this;
+    }
+
+    // Destructor
+    ~SmallVector() {
+        release();
+    }
+
+    // Bounds‐checked operator[]
+    T& operator[](size_t i) {
+        assert(i < _size);
+        return _data[i];
+    }
+    const T& operator[](size_t i) const {
+        assert(i < _size);
+        return _data[i];
+    }
+
+    // Return current number of elements
+    size_t size() const { return _size; }
+
+    // Number of elements the current storage can hold (N while inline)
+    size_t capacity() const { return _capacity; }
+
+    // Contiguous storage and iteration
+    T* data() { return _data; }
+    const T* data() const { return _data; }
+    iterator begin() { return _data; }
+    iterator end() { return _data + _size; }
+    const_iterator begin() const { return _data; }
+    const_iterator end() const { return _data + _size; }
+
+    // True if empty
+    bool empty() const { return _size == 0; }
+
+    // Allocator used once the inline slots are exhausted
+    const Alloc& get_allocator() const { return *this; }
+
+    // Make room for at least n elements without changing the size
+    void reserve(size_t n) {
+        if (n <= _capacity) return;
+        adopt(grow(n), n);
+    }
+
+    // Grow (value-initializing the new elements) or shrink to exactly n elements
+    void resize(size_t n) {
+        reserve(n);
+        for (size_t i = _size; i < n; ++i) {
+            new (&_data[i]) T();
+        }
+        for (size_t i = n; i < _size; ++i) {
+            _data[i].~T();
+        }
+        _size = n;
+    }
+
+    // Add a copy of value at the end
+    void push_back(const T& value) {
+        if (_size >= _capacity) {
+            size_t newCap = _capacity * 2;
+            T* newData = allocateN(newCap);
+            // Construct the new element first, "value" may live inside this vector
+            new (&newData[_size]) T(value);
+            for (size_t j = 0; j < _size; ++j) {
+                new (&newData[j]) T(std::move(_data[j]));
+                _data[j].~T();
+            }
+            adopt(newData, newCap);
+        }
+        else {
+            new (&_data[_size]) T(value);
+        }
+        _size++;
+    }
+
+    // Add a moved value at the end
+    void push_back(T&& value) {
+        if (_size >= _capacity) {
+            size_t newCap = _capacity * 2;
+            adopt(grow(newCap), newCap);
+        }
+        new (&_data[_size]) T(std::move(value));
+        _size++;
+    }
+
+    // Remove last element
+    void pop_back() {
+        assert(_size > 0);
+        _data[_size - 1].~T();
+        _size--;
+    }
+
+    // Remove all elements (keeps any heap block for reuse)
+    void clear() {
+        for (size_t i = 0; i < _size; ++i) {
+            _data[i].~T();
+        }
+        _size = 0;
+    }
+};
+
+#endif // SMALLVECTOR_H
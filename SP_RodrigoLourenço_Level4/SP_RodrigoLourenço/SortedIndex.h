@@ -0,0 +1,78 @@
+// SortedIndex.h
+#ifndef SORTEDINDEX_H
+#define SORTEDINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include "Vector.h"
+#include "Span.h"
+
+// Static secondary index: (key, row) pairs sorted by key, rows ascending among
+// equal keys. Built once with add() + finish(); range lookups are two binary
+// searches and return the matching entries already in key order.
+template<typename Key>
+class SortedIndex {
+public:
+    struct Entry {
+        Key key;
+        uint32_t row;
+    };
+
+private:
+    Vector<Entry> entries;
+
+    static bool keyBelow(const Entry& e, const Key& k) { return e.key < k; }
+    static bool keyAbove(const Key& k, const Entry& e) { return k < e.key; }
+    static bool entryLess(const Entry& a, const Entry& b) {
+        return a.key < b.key || (!(b.key < a.key) && a.row < b.row);
+    }
+
+public:
+    void add(const Key& key, uint32_t row) {
+        entries.push_back(Entry{ key, row });
+    }
+
+    // Sort the added entries; call once after the last add()
+    void finish() {
+        std::sort(entries.begin(), entries.end(), entryLess);
+    }
+
+    // The key of 'row' changed from oldKey to newKey: its entry is found by binary
+    // search and moved to its new place, shifting only the entries in between.
+    // Returns false when there is no (oldKey, row) entry.
+    bool rekey(const Key& oldKey, uint32_t row, const Key& newKey) {
+        const Entry old{ oldKey, row };
+        Entry* first = entries.begin();
+        Entry* last = entries.end();
+        Entry* at = std::lower_bound(first, last, old, entryLess);
+        if (at == last || entryLess(old, *at)) return false;
+        const Entry moved{ newKey, row };
+        if (entryLess(moved, *at)) {
+            Entry* to = std::lower_bound(first, at, moved, entryLess);
+            std::move_backward(to, at, at + 1);
+            *to = moved;
+        }
+        else {
+            Entry* to = std::lower_bound(at + 1, last, moved, entryLess);
+            std::move(at + 1, to, at);
+            *(to - 1) = moved;
+        }
+        return true;
+    }
+
+    // Entries with lo <= key <= hi, in (key, row) order
+    Span<const Entry> between(const Key& lo, const Key& hi) const {
+        const Entry* first = std::lower_bound(entries.begin(), entries.end(), lo, keyBelow);
+        const Entry* last = std::upper_bound(first, entries.end(), hi, keyAbove);
+        if (last < first) last = first;   // lo > hi
+        return Span<const Entry>(first, static_cast<size_t>(last - first));
+    }
+
+    void clear() { entries.clear(); }
+    size_t size() const { return entries.size(); }
+    size_t memoryBytes() const { return sizeof(*this) + entries.capacity() * sizeof(Entry); }
+    Span<const Entry> all() const { return Span<const Entry>(entries.data(), entries.size()); }
+};
+
+#endif // SORTEDINDEX_H
\ No newline at end of file
@@ -0,0 +1,49 @@
+// Span.h
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <cstddef>
+#include <cassert>
+
+// Non-owning view of a contiguous run of T (a Vector, a SmallVector, or a slice of one).
+// Copying a Span never copies the elements.
+template<typename T>
+class Span {
+private:
+    T* ptr = nullptr;
+    size_t len = 0;
+
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = T*;
+
+    Span() = default;
+    Span(T* p, size_t n) : ptr(p), len(n) {}
+
+    // View the whole of any contiguous container (Vector, SmallVector, Span<U>)
+    template<typename Container>
+    Span(Container& c) : ptr(c.data()), len(c.size()) {}
+    template<typename Container>
+    Span(const Container& c) : ptr(c.data()), len(c.size()) {}
+
+    T& operator[](size_t i) const {
+        assert(i < len);
+        return ptr[i];
+    }
+
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+    T* data() const { return ptr; }
+    T* begin() const { return ptr; }
+    T* end() const { return ptr + len; }
+
+    // Sub-view of "count" elements starting at "offset"
+    Span subspan(size_t offset, size_t count) const {
+        assert(offset + count <= len);
+        return Span(ptr + offset, count);
+    }
+    Span first(size_t count) const { return subspan(0, count < len ? count : len); }
+};
+
+#endif // SPAN_H
@@ -0,0 +1,158 @@
+// Stats.h
+#ifndef STATS_H
+#define STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include "ResultWriter.h"
+
+// Optional instrumentation. Compile with SP_STATS defined (-DSP_STATS, or SP_STATS
+// in the project's preprocessor definitions) to count hash probes, comparisons and
+// bytes read, and to time every block wrapped in STATS_SCOPE. Without it the
+// macros below expand to nothing: no counters, no clock reads on the hot paths.
+namespace stats {
+
+#ifdef SP_STATS
+const bool ENABLED = true;
+#else
+const bool ENABLED = false;
+#endif
+
+enum Counter {
+    HashLookups,     // operator[] / find / erase calls on any HashMap
+    HashProbes,      // Keys compared while walking bucket chains
+    HashChainMax,    // Longest bucket chain walked by a lookup
+    Comparisons,     // Sort comparator calls
+    BytesRead,       // Input bytes consumed by the CSV loaders
+    COUNTER_COUNT
+};
+
+inline const char* counterName(Counter c) {
+    static const char* const NAMES[COUNTER_COUNT] = {
+        "hash_lookups", "hash_probes", "hash_chain_max", "comparisons", "bytes_read"
+    };
+    return NAMES[c];
+}
+
+inline std::atomic<uint64_t>& counter(Counter c) {
+    static std::atomic<uint64_t> values[COUNTER_COUNT];
+    return values[c];
+}
+
+inline void add(Counter c, uint64_t n) {
+    counter(c).fetch_add(n, std::memory_order_relaxed);
+}
+
+// counter = max(counter, v)
+inline void raiseTo(Counter c, uint64_t v) {
+    std::atomic<uint64_t>& cur = counter(c);
+    uint64_t seen = cur.load(std::memory_order_relaxed);
+    while (seen < v && !cur.compare_exchange_weak(seen, v, std::memory_order_relaxed)) {
+    }
+}
+
+// Total time and number of runs of one named scope
+struct Timer {
+    std::string name;
+    std::atomic<uint64_t> ns{ 0 };
+    std::atomic<uint64_t> calls{ 0 };
+};
+
+// Named timers in first-use order. Slots never move, so a Timer& stays valid;
+// names beyond MAX_TIMERS all share the last slot ("other").
+class TimerRegistry {
+public:
+    static const size_t MAX_TIMERS = 64;
+
+private:
+    Timer timers[MAX_TIMERS];
+    size_t count = 0;
+    mutable std::mutex mtx;
+
+public:
+    Timer& get(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (size_t i = 0; i < count; ++i) {
+            if (timers[i].name == name) return timers[i];
+        }
+        if (count == MAX_TIMERS) return timers[MAX_TIMERS - 1];
+        timers[count].name = (count + 1 == MAX_TIMERS) ? std::string("other") : name;
+        return timers[count++];
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return count;
+    }
+
+    const Timer& at(size_t i) const { return timers[i]; }
+};
+
+inline TimerRegistry& timers() {
+    static TimerRegistry registry;
+    return registry;
+}
+
+inline Timer& timer(const std::string& name) { return timers().get(name); }
+
+// Adds the time from construction to destruction to a Timer
+class ScopedTimer {
+private:
+    Timer& t;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit ScopedTimer(Timer& timer) : t(timer), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        t.ns.fetch_add(ns, std::memory_order_relaxed);
+        t.calls.fetch_add(1, std::memory_order_relaxed);
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+// One record per counter and per timer (Csv / Jsonl writers)
+inline void report(ResultWriter& out) {
+    for (int c = 0; c < COUNTER_COUNT; ++c) {
+        out.beginRecord();
+        out.field("kind", "counter");
+        out.field("name", counterName(static_cast<Counter>(c)));
+        out.field("value", static_cast<size_t>(counter(static_cast<Counter>(c)).load()));
+        out.endRecord();
+    }
+    out.newResultSet();
+    TimerRegistry& reg = timers();
+    size_t n = reg.size();
+    for (size_t i = 0; i < n; ++i) {
+        const Timer& t = reg.at(i);
+        out.beginRecord();
+        out.field("kind", "timer");
+        out.field("name", t.name);
+        out.field("calls", static_cast<size_t>(t.calls.load()));
+        out.field("ms", static_cast<double>(t.ns.load()) / 1e6);
+        out.endRecord();
+    }
+    out.newResultSet();
+}
+
+} // namespace stats
+
+#ifdef SP_STATS
+#  define STATS_CONCAT_(a, b) a##b
+#  define STATS_CONCAT(a, b) STATS_CONCAT_(a, b)
+#  define STATS_COUNT(c, n) ::stats::add(::stats::c, static_cast<uint64_t>(n))
+#  define STATS_MAX(c, v)   ::stats::raiseTo(::stats::c, static_cast<uint64_t>(v))
+#  define STATS_SCOPE(name) ::stats::ScopedTimer STATS_CONCAT(statsScope_, __LINE__)(::stats::timer(name))
+#else
+#  define STATS_COUNT(c, n) ((void)0)
+#  define STATS_MAX(c, v)   ((void)0)
+#  define STATS_SCOPE(name) ((void)0)
+#endif
+
+#endif // STATS_H
\ No newline at end of file
@@ -0,0 +1,319 @@
+// ThreadPool.h
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <algorithm>
+#include "Vector.h"
+
+// Work-stealing thread pool for intra-query parallelism.
+// Every worker owns a deque of tasks: it pushes and pops at the back (newest,
+// still in cache) and, when it runs dry, steals from the front of the other
+// deques (oldest, usually the biggest pieces). Threads that are not workers
+// (the main thread, server workers) push into a shared injection queue.
+// Waiting for a TaskGroup runs pending tasks instead of blocking, so nested
+// fork/join (the merge sort below) cannot deadlock. Tasks must not throw.
+
+// Number of unfinished tasks of one fork/join region
+class TaskGroup {
+private:
+    std::atomic<size_t> pending{ 0 };
+    friend class ThreadPool;
+
+public:
+    TaskGroup() = default;
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+};
+
+class ThreadPool {
+private:
+    struct Task {
+        void (*run)(void*);
+        void* fn;
+        TaskGroup* group;
+    };
+
+    struct Queue {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+    };
+
+    struct WorkerSlot {
+        const ThreadPool* pool;
+        size_t index;
+    };
+
+    Vector<Queue*> queues;          // One per worker, the injection queue last
+    Vector<std::thread*> threads;
+    std::atomic<size_t> queued{ 0 };
+    std::mutex sleepMtx;
+    std::condition_variable wake;
+    bool stopping = false;          // Guarded by sleepMtx
+
+    static WorkerSlot& self() {
+        thread_local WorkerSlot s = { nullptr, 0 };
+        return s;
+    }
+
+    // Queue this thread pushes to: its own deque, or the injection queue
+    size_t ownQueue() const {
+        return self().pool == this ? self().index : threads.size();
+    }
+
+    void push(const Task& t) {
+        t.group->pending.fetch_add(1, std::memory_order_relaxed);
+        Queue* q = queues[ownQueue()];
+        {
+            std::lock_guard<std::mutex> lock(q->mtx);
+            q->tasks.push_back(t);
+        }
+        queued.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(sleepMtx);   // Pairs with the check in workerLoop
+        }
+        wake.notify_one();
+    }
+
+    bool popOwn(Task& t) {
+        Queue* q = queues[ownQueue()];
+        std::lock_guard<std::mutex> lock(q->mtx);
+        if (q->tasks.empty()) return false;
+        t = q->tasks.back();
+        q->tasks.pop_back();
+        return true;
+    }
+
+    bool steal(Task& t) {
+        size_t own = ownQueue();
+        for (size_t k = 1; k < queues.size(); ++k) {
+            Queue* q = queues[(own + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(q->mtx);
+            if (!q->tasks.empty()) {
+                t = q->tasks.front();
+                q->tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Run one pending task, if there is any
+    bool runOne() {
+        Task t;
+        if (!popOwn(t) && !steal(t)) return false;
+        queued.fetch_sub(1);
+        t.run(t.fn);
+        t.group->pending.fetch_sub(1, std::memory_order_release);
+        return true;
+    }
+
+    void workerLoop(size_t index) {
+        self().pool = this;
+        self().index = index;
+        while (true) {
+            if (runOne()) continue;
+            std::unique_lock<std::mutex> lock(sleepMtx);
+            wake.wait(lock, [&] { return stopping || queued.load() > 0; });
+            if (stopping) return;
+        }
+    }
+
+    static ThreadPool*& currentSlot() {
+        static ThreadPool* p = nullptr;
+        return p;
+    }
+
+public:
+    // 'workers' background threads; the threads that wait for results help as well
+    explicit ThreadPool(size_t workers) {
+        for (size_t i = 0; i <= workers; ++i) {
+            queues.push_back(new Queue());
+        }
+        for (size_t i = 0; i < workers; ++i) {
+            threads.push_back(new std::thread([this, i] { workerLoop(i); }));
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMtx);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (size_t i = 0; i < threads.size(); ++i) {
+            threads[i]->join();
+            delete threads[i];
+        }
+        for (size_t i = 0; i < queues.size(); ++i) {
+            delete queues[i];
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t workerCount() const { return threads.size(); }
+
+    // Queue fn() as part of 'group'; fn must stay alive until wait(group) returns
+    template<typename F>
+    void spawn(TaskGroup& group, F& fn) {
+        Task t;
+        t.run = [](void* p) { (*static_cast<F*>(p))(); };
+        t.fn = &fn;
+        t.group = &group;
+        push(t);
+    }
+
+    // Help with pending tasks until every task of 'group' has finished
+    void wait(TaskGroup& group) {
+        while (group.pending.load(std::memory_order_acquire) > 0) {
+            if (!runOne()) std::this_thread::yield();
+        }
+    }
+
+    // Pool used by the query operators (nullptr: everything runs on the calling thread)
+    static ThreadPool* current() { return currentSlot(); }
+    static ThreadPool* setCurrent(ThreadPool* p) {
+        ThreadPool* old = currentSlot();
+        currentSlot() = p;
+        return old;
+    }
+};
+
+// === Parallel algorithms ===
+// All of them take the pool explicitly; with a null pool they run sequentially
+// on the calling thread and give exactly the same result.
+
+// Morsel-parallel scan: scan(lo, hi, out) appends the results for [lo, hi) to out.
+// Morsels are 'grain' items; their outputs are concatenated in order, so the
+// result is identical to one sequential scan(0, n, out).
+template<typename T, typename Scan>
+Vector<T> parallelCollect(ThreadPool* pool, size_t n, size_t grain, const Scan& scan) {
+    Vector<T> out;
+    if (!pool || pool->workerCount() == 0 || n <= grain) {
+        scan(0, n, out);
+        return out;
+    }
+
+    struct Morsel {
+        const Scan* scan;
+        size_t lo, hi;
+        Vector<T> out;
+        void operator()() { (*scan)(lo, hi, out); }
+    };
+    size_t count = (n + grain - 1) / grain;
+    Vector<Morsel> morsels;
+    morsels.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        Morsel m;
+        m.scan = &scan;
+        m.lo = i * grain;
+        m.hi = std::min(n, m.lo + grain);
+        morsels.push_back(std::move(m));
+    }
+
+    TaskGroup group;
+    for (size_t i = 1; i < count; ++i) {
+        pool->spawn(group, morsels[i]);
+    }
+    morsels[0]();
+    pool->wait(group);
+
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) total += morsels[i].out.size();
+    out.reserve(total);
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t j = 0; j < morsels[i].out.size(); ++j) {
+            out.push_back(std::move(morsels[i].out[j]));
+        }
+    }
+    return out;
+}
+
+// Stable merge of the sorted runs a[0, na) and b[0, nb) into out; large merges
+// are split around a pivot and the two halves merged in parallel
+template<typename T, typename Less>
+void parallelMerge(ThreadPool* pool, const T* a, size_t na, const T* b, size_t nb,
+    T* out, const Less& less, size_t grain)
+{
+    if (!pool || na + nb <= grain) {
+        std::merge(a, a + na, b, b + nb, out, less);
+        return;
+    }
+    size_t ia, ib;
+    if (na >= nb) {
+        // Elements of b equal to the pivot stay after it (a comes first on ties)
+        ia = na / 2;
+        ib = static_cast<size_t>(std::lower_bound(b, b + nb, a[ia], less) - b);
+    }
+    else {
+        ib = nb / 2;
+        ia = static_cast<size_t>(std::upper_bound(a, a + na, b[ib], less) - a);
+    }
+
+    struct Left {
+        ThreadPool* pool;
+        const T* a; size_t na;
+        const T* b; size_t nb;
+        T* out;
+        const Less* less;
+        size_t grain;
+        void operator()() { parallelMerge(pool, a, na, b, nb, out, *less, grain); }
+    };
+    Left left = { pool, a, ia, b, ib, out, &less, grain };
+    TaskGroup group;
+    pool->spawn(group, left);
+    parallelMerge(pool, a + ia, na - ia, b + ib, nb - ib, out + ia + ib, less, grain);
+    pool->wait(group);
+}
+
+// Sorts a[0, n) and leaves the result in b when 'intoB', otherwise in a.
+// The halves are sorted into the other array so no copy-back pass is needed.
+template<typename T, typename Less>
+void mergeSortInto(ThreadPool* pool, T* a, T* b, size_t n, const Less& less, size_t grain, bool intoB) {
+    if (n <= grain) {
+        std::stable_sort(a, a + n, less);
+        if (intoB) std::copy(a, a + n, b);
+        return;
+    }
+    size_t h = n / 2;
+    struct Half {
+        ThreadPool* pool;
+        T* a; T* b;
+        size_t n;
+        const Less* less;
+        size_t grain;
+        bool intoB;
+        void operator()() { mergeSortInto(pool, a, b, n, *less, grain, intoB); }
+    };
+    Half left = { pool, a, b, h, &less, grain, !intoB };
+    TaskGroup group;
+    pool->spawn(group, left);
+    mergeSortInto(pool, a + h, b + h, n - h, less, grain, !intoB);
+    pool->wait(group);
+
+    T* src = intoB ? a : b;
+    T* dst = intoB ? b : a;
+    parallelMerge(pool, src, h, src + h, n - h, dst, less, grain);
+}
+
+// Stable sort of data[0, n); runs of 'grain' elements are sorted by one task each
+template<typename T, typename Less>
+void parallelMergeSort(ThreadPool* pool, T* data, size_t n, const Less& less, size_t grain) {
+    if (!pool || pool->workerCount() == 0 || n <= grain) {
+        std::stable_sort(data, data + n, less);
+        return;
+    }
+    Vector<T> buf;
+    buf.reserve(n);
+    for (size_t i = 0; i < n; ++i) buf.push_back(data[i]);
+    mergeSortInto(pool, data, buf.data(), n, less, grain, false);
+}
+
+#endif // THREADPOOL_H
\ No newline at end of file
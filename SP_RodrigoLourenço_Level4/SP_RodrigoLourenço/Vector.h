@@ -5,24 +5,42 @@
 #include <cstddef>
 #include <new>
 #include <cassert>
+#include <utility>
+#include "Allocator.h"
 
-template<typename T>
-class Vector {
+// Alloc is stored as a (usually empty) base class so HeapAllocator costs no space
+template<typename T, typename Alloc = HeapAllocator>
+class Vector : private Alloc {
 private:
-    T* data = nullptr;
+    T* _data = nullptr;
     size_t _size = 0;
     size_t _capacity = 0;
 
+    Alloc& allocator() { return *this; }
+
+    T* allocateN(size_t n) {
+        return static_cast<T*>(allocator().allocate(n * sizeof(T), alignof(T)));
+    }
+    void freeData() {
+        allocator().deallocate(_data, _capacity * sizeof(T), alignof(T));
+    }
+
 public:
+    // Plain pointers are random-access iterators
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
     Vector() = default;
+    explicit Vector(const Alloc& a) : Alloc(a) {}
 
-    // Copy constructor
+    // Copy constructor (uses a copy of other's allocator)
     Vector(const Vector& other)
-        : data(nullptr), _size(other._size), _capacity(other._capacity) {
+        : Alloc(other.get_allocator()), _data(nullptr), _size(other._size), _capacity(other._capacity) {
         if (_capacity > 0) {
-            data = static_cast<T*>(operator new[](_capacity * sizeof(T)));
+            _data = allocateN(_capacity);
             for (size_t i = 0; i < _size; ++i) {
-                new (&data[i]) T(other.data[i]);
+                new (&_data[i]) T(other._data[i]);
             }
         }
     }
@@ -32,17 +50,17 @@ public:
         if (this == &other) return *this;
         // Destroy existing
         for (size_t i = 0; i < _size; ++i) {
-            data[i].~T();
+            _data[i].~T();
         }
-        operator delete[](data);
+        freeData();
 
         _size = other._size;
         _capacity = other._capacity;
-        data = nullptr;
+        _data = nullptr;
         if (_capacity > 0) {
-            data = static_cast<T*>(operator new[](_capacity * sizeof(T)));
+            _data = allocateN(_capacity);
             for (size_t i = 0; i < _size; ++i) {
-                new (&data[i]) T(other.data[i]);
+                new (&_data[i]) T(other._data[i]);
             }
         }
         return *this;
@@ -50,8 +68,8 @@ public:
 
     // Move constructor
     Vector(Vector&& other) noexcept
-        : data(other.data), _size(other._size), _capacity(other._capacity) {
-        other.data = nullptr;
+        : Alloc(other.get_allocator()), _data(other._data), _size(other._size), _capacity(other._capacity) {
+        other._data = nullptr;
         other._size = 0;
         other._capacity = 0;
     }
@@ -61,16 +79,17 @@ public:
         if (this == &other) return *this;
         // Destroy existing
         for (size_t i = 0; i < _size; ++i) {
-            data[i].~T();
+            _data[i].~T();
         }
-        operator delete[](data);
+        freeData();
 
-        // Steal other's data
-        data = other.data;
+        // Steal other's data (and the allocator that owns it)
+        allocator() = other.get_allocator();
+        _data = other._data;
         _size = other._size;
         _capacity = other._capacity;
 
-        other.data = nullptr;
+        other._data = nullptr;
         other._size = 0;
         other._capacity = 0;
         return *this;
@@ -79,41 +98,80 @@ public:
     // Destructor
     ~Vector() {
         for (size_t i = 0; i < _size; ++i) {
-            data[i].~T();
+            _data[i].~T();
         }
-        operator delete[](data);
+        freeData();
     }
 
     // Bounds‐checked operator[]
     T& operator[](size_t i) {
         assert(i < _size);   // CRASH immediately if i >= _size
-        return data[i];
+        return _data[i];
     }
     const T& operator[](size_t i) const {
         assert(i < _size);
-        return data[i];
+        return _data[i];
     }
 
     // Return current number of elements
     size_t size() const { return _size; }
 
+    // Number of elements the current storage can hold
+    size_t capacity() const { return _capacity; }
+
+    // Contiguous storage and iteration
+    T* data() { return _data; }
+    const T* data() const { return _data; }
+    iterator begin() { return _data; }
+    iterator end() { return _data + _size; }
+    const_iterator begin() const { return _data; }
+    const_iterator end() const { return _data + _size; }
+
     // True if empty
     bool empty() const { return _size == 0; }
 
+    // Allocator this vector draws its storage from
+    const Alloc& get_allocator() const { return *this; }
+
+    // Make room for at least n elements without changing the size
+    void reserve(size_t n) {
+        if (n <= _capacity) return;
+        T* newData = allocateN(n);
+        for (size_t j = 0; j < _size; ++j) {
+            new (&newData[j]) T(std::move(_data[j]));
+            _data[j].~T();
+        }
+        freeData();
+        _data = newData;
+        _capacity = n;
+    }
+
+    // Grow (value-initializing the new elements) or shrink to exactly n elements
+    void resize(size_t n) {
+        reserve(n);
+        for (size_t i = _size; i < n; ++i) {
+            new (&_data[i]) T();
+        }
+        for (size_t i = n; i < _size; ++i) {
+            _data[i].~T();
+        }
+        _size = n;
+    }
+
     // Add a copy of value at the end
     void push_back(const T& value) {
         if (_size >= _capacity) {
             size_t newCap = (_capacity == 0 ? 1 : _capacity * 2);
-            T* newData = static_cast<T*>(operator new[](newCap * sizeof(T)));
+            T* newData = allocateN(newCap);
             for (size_t j = 0; j < _size; ++j) {
-                new (&newData[j]) T(std::move(data[j]));
-                data[j].~T();
+                new (&newData[j]) T(std::move(_data[j]));
+                _data[j].~T();
             }
-            operator delete[](data);
-            data = newData;
+            freeData();
+            _data = newData;
             _capacity = newCap;
         }
-        new (&data[_size]) T(value);
+        new (&_data[_size]) T(value);
         _size++;
     }
 
@@ -121,30 +179,30 @@ public:
     void push_back(T&& value) {
         if (_size >= _capacity) {
             size_t newCap = (_capacity == 0 ? 1 : _capacity * 2);
-            T* newData = static_cast<T*>(operator new[](newCap * sizeof(T)));
+            T* newData = allocateN(newCap);
             for (size_t j = 0; j < _size; ++j) {
-                new (&newData[j]) T(std::move(data[j]));
-                data[j].~T();
+                new (&newData[j]) T(std::move(_data[j]));
+                _data[j].~T();
             }
-            operator delete[](data);
-            data = newData;
+            freeData();
+            _data = newData;
             _capacity = newCap;
         }
-        new (&data[_size]) T(std::move(value));
+        new (&_data[_size]) T(std::move(value));
         _size++;
     }
 
     // Remove last element
     void pop_back() {
         assert(_size > 0);
-        data[_size - 1].~T();
+        _data[_size - 1].~T();
         _size--;
     }
 
     // Remove all elements
     void clear() {
         for (size_t i = 0; i < _size; ++i) {
-            data[i].~T();
+            _data[i].~T();
         }
         _size = 0;
     }